@@ -1,7 +1,9 @@
 #include "agente.h"
+#include "rng.h"
 
-void executar_carga(double recurso) {
-  long iteracoes = (long)(recurso * 1000);
+// fator_carga = iterações por unidade de recurso (0 desliga a carga)
+void executar_carga(double recurso, int fator_carga) {
+  long iteracoes = (long)(recurso * fator_carga);
   if (iteracoes > MAX_CUSTO_CARGA)
     iteracoes = MAX_CUSTO_CARGA;
 
@@ -11,3 +13,10 @@ void executar_carga(double recurso) {
     dummy += (c * 0.0001);
   }
 }
+
+// Hash de (id, posição global) usado no checksum de reprodutibilidade. A soma
+// das assinaturas não depende da ordem dos agentes nem da decomposição.
+uint64_t assinatura_agente(uint64_t id, int gx, int gy) {
+  uint64_t pos = ((uint64_t)(uint32_t)gx << 32) | (uint32_t)gy;
+  return rng_misturar(rng_misturar(id) ^ pos);
+}
@@ -1,21 +1,19 @@
 #ifndef AGENTE_H
 #define AGENTE_H
 
+#include <stdint.h>
+
 #define MAX_CUSTO_CARGA 1000000
-#define MAX_AG_THREAD 1000
 
 typedef struct {
   int x, y;   // Posições locais
   int gx, gy; // Posições globais
   double energia;
+  uint64_t id; // Identificador global, chave do gerador aleatório
 } Agente;
 
-typedef struct {
-  Agente agentes[MAX_AG_THREAD];
-  int count;
-} ThreadBuffer;
-
 // Assinaturas
-void executar_carga(double recurso);
+void executar_carga(double recurso, int fator_carga);
+uint64_t assinatura_agente(uint64_t id, int gx, int gy);
 
 #endif
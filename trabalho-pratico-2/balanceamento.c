@@ -0,0 +1,349 @@
+#include "balanceamento.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Só reparte se o processo mais lento passar da média por mais do que isto;
+// abaixo disso o custo de mover células e agentes não compensa o ruído.
+#define LIMIAR_DESBALANCEAMENTO 1.05
+
+// Custos fixos da estimativa, em iterações de carga sintética: o trabalho de
+// um agente por ciclo (movimento, consumo, energia, compactação) e o de uma
+// célula (regeneração e soma das métricas).
+#define CUSTO_AGENTE 16.0
+#define CUSTO_CELULA 1.0
+
+typedef struct {
+  int x0, x1; // Colunas globais [x0, x1)
+  int y0, y1; // Linhas globais [y0, y1)
+} Retangulo;
+
+// Bloco do rank r segundo os limites lx/ly.
+static Retangulo bloco(const Dominio *d, const int *lx, const int *ly, int r) {
+  int c[2];
+  MPI_Cart_coords(d->comm, r, 2, c);
+  Retangulo b = {lx[c[1]], lx[c[1] + 1], ly[c[0]], ly[c[0] + 1]};
+  return b;
+}
+
+// Interseção de a e b em r; retorna o número de células (0 se vazia).
+static int intersecao(Retangulo a, Retangulo b, Retangulo *r) {
+  r->x0 = (a.x0 > b.x0) ? a.x0 : b.x0;
+  r->x1 = (a.x1 < b.x1) ? a.x1 : b.x1;
+  r->y0 = (a.y0 > b.y0) ? a.y0 : b.y0;
+  r->y1 = (a.y1 < b.y1) ? a.y1 : b.y1;
+  if (r->x1 <= r->x0 || r->y1 <= r->y0) {
+    return 0;
+  }
+  return (r->x1 - r->x0) * (r->y1 - r->y0);
+}
+
+// Custo estimado de um agente: o trabalho fixo mais a carga sintética da
+// célula onde está (a mesma conta de executar_carga).
+static double custo_agente(const Balanceamento *b, const Dominio *d,
+                           const Grid *g, const Populacao *p, int i) {
+  double carga = g->recurso[dominio_idx(d, p->x[i], p->y[i])] * b->fator_carga;
+  if (carga > MAX_CUSTO_CARGA)
+    carga = MAX_CUSTO_CARGA;
+  return CUSTO_AGENTE + carga;
+}
+
+// Divide n pesos em p faixas contíguas de peso parecido, cada uma com ao
+// menos uma fileira: o limite k fica na fileira em que a soma acumulada mais
+// se aproxima de k/p do total.
+static void dividir_pesos(const double *peso, int n, int p, int *limites) {
+  double total = 0.0;
+  for (int i = 0; i < n; i++) {
+    total += peso[i];
+  }
+
+  limites[0] = 0;
+  limites[p] = n;
+  double acumulado = 0.0; // Soma de peso[0, i)
+  int i = 0;
+  for (int k = 1; k < p; k++) {
+    double alvo = total * k / p;
+    while (i < n - (p - k) && acumulado + 0.5 * peso[i] < alvo) {
+      acumulado += peso[i++];
+    }
+    while (i <= limites[k - 1]) {
+      acumulado += peso[i++];
+    }
+    limites[k] = i;
+  }
+}
+
+// Razão entre o maior valor e a média (1 = perfeitamente balanceado).
+static double desbalanceamento(const double *v, int n) {
+  double maior = 0.0, soma = 0.0;
+  for (int k = 0; k < n; k++) {
+    soma += v[k];
+    if (v[k] > maior)
+      maior = v[k];
+  }
+  return (soma > 0.0) ? maior / (soma / n) : 1.0;
+}
+
+static void reservar_doubles(double **v, int *capacidade, int n) {
+  if (n > *capacidade) {
+    *capacidade = n;
+    *v = (double *)realloc(*v, n * sizeof(double));
+    if (*v == NULL) {
+      printf("Erro: sem memoria para redistribuir o grid (%d celulas)\n", n);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+}
+
+void balanceamento_iniciar(Balanceamento *b, const Dominio *d, int intervalo,
+                           int fator_carga) {
+  memset(b, 0, sizeof(*b));
+  // Com um só processo não há o que balancear
+  b->intervalo = (d->size > 1) ? intervalo : 0;
+  b->fator_carga = fator_carga;
+  b->desbalanceamento_medido = 1.0;
+  b->desbalanceamento_estimado = 1.0;
+
+  b->peso = (double *)malloc((d->H_global + d->W_global) * sizeof(double));
+  b->peso_blocos = (double *)malloc(d->size * sizeof(double));
+  b->novos_limites_y = (int *)malloc((d->dims[0] + 1) * sizeof(int));
+  b->novos_limites_x = (int *)malloc((d->dims[1] + 1) * sizeof(int));
+  b->limites_antigos_y = (int *)malloc((d->dims[0] + 1) * sizeof(int));
+  b->limites_antigos_x = (int *)malloc((d->dims[1] + 1) * sizeof(int));
+  b->contagem_envio = (int *)malloc(d->size * sizeof(int));
+  b->desloc_envio = (int *)malloc(d->size * sizeof(int));
+  b->contagem_recepcao = (int *)malloc(d->size * sizeof(int));
+  b->desloc_recepcao = (int *)malloc(d->size * sizeof(int));
+  buffer_iniciar(&b->agentes_envio, 64);
+  buffer_iniciar(&b->agentes_recepcao, 64);
+}
+
+void balanceamento_liberar(Balanceamento *b) {
+  free(b->peso);
+  free(b->peso_blocos);
+  free(b->novos_limites_y);
+  free(b->novos_limites_x);
+  free(b->limites_antigos_y);
+  free(b->limites_antigos_x);
+  free(b->contagem_envio);
+  free(b->desloc_envio);
+  free(b->contagem_recepcao);
+  free(b->desloc_recepcao);
+  free(b->recurso_envio);
+  free(b->recurso_recepcao);
+  buffer_liberar(&b->agentes_envio);
+  buffer_liberar(&b->agentes_recepcao);
+}
+
+// Soma de prefixos de contagem em desloc; retorna o total.
+static int prefixos(const int *contagem, int *desloc, int n) {
+  int total = 0;
+  for (int r = 0; r < n; r++) {
+    desloc[r] = total;
+    total += contagem[r];
+  }
+  return total;
+}
+
+// Envia o recurso das células do bloco atual aos donos delas nos novos
+// limites (b->novos_limites_*), refaz o domínio e o grid e desempacota as
+// células recebidas. Cada par de processos troca a interseção retangular
+// entre o bloco antigo de um e o novo do outro, em ordem de linhas.
+static void redistribuir_grid(Balanceamento *b, Dominio *d, Grid *g) {
+  Retangulo antigo = bloco(d, d->limites_x, d->limites_y, d->rank);
+  Retangulo novo = bloco(d, b->novos_limites_x, b->novos_limites_y, d->rank);
+  Retangulo r;
+
+  for (int q = 0; q < d->size; q++) {
+    b->contagem_envio[q] = intersecao(
+        antigo, bloco(d, b->novos_limites_x, b->novos_limites_y, q), &r);
+    b->contagem_recepcao[q] =
+        intersecao(bloco(d, d->limites_x, d->limites_y, q), novo, &r);
+  }
+  int total_envio = prefixos(b->contagem_envio, b->desloc_envio, d->size);
+  int total_recepcao =
+      prefixos(b->contagem_recepcao, b->desloc_recepcao, d->size);
+  reservar_doubles(&b->recurso_envio, &b->capacidade_recurso_envio,
+                   total_envio);
+  reservar_doubles(&b->recurso_recepcao, &b->capacidade_recurso_recepcao,
+                   total_recepcao);
+
+  int pos = 0;
+  for (int q = 0; q < d->size; q++) {
+    if (intersecao(antigo, bloco(d, b->novos_limites_x, b->novos_limites_y, q),
+                   &r) == 0)
+      continue;
+    for (int gy = r.y0; gy < r.y1; gy++) {
+      for (int gx = r.x0; gx < r.x1; gx++) {
+        b->recurso_envio[pos++] =
+            g->recurso[dominio_idx(d, gx - d->offsetX, gy - d->offsetY)];
+      }
+    }
+  }
+
+  MPI_Alltoallv(b->recurso_envio, b->contagem_envio, b->desloc_envio,
+                MPI_DOUBLE, b->recurso_recepcao, b->contagem_recepcao,
+                b->desloc_recepcao, MPI_DOUBLE, d->comm);
+
+  memcpy(b->limites_antigos_x, d->limites_x, (d->dims[1] + 1) * sizeof(int));
+  memcpy(b->limites_antigos_y, d->limites_y, (d->dims[0] + 1) * sizeof(int));
+  dominio_repartir(d, b->novos_limites_x, b->novos_limites_y);
+  grid_redimensionar(g, dominio_celulas_com_halo(d));
+  grid_preencher(g, d);
+
+  pos = 0;
+  for (int q = 0; q < d->size; q++) {
+    if (intersecao(bloco(d, b->limites_antigos_x, b->limites_antigos_y, q),
+                   novo, &r) == 0)
+      continue;
+    for (int gy = r.y0; gy < r.y1; gy++) {
+      for (int gx = r.x0; gx < r.x1; gx++) {
+        g->recurso[dominio_idx(d, gx - d->offsetX, gy - d->offsetY)] =
+            b->recurso_recepcao[pos++];
+      }
+    }
+  }
+}
+
+// Envia cada agente ao dono da sua posição no domínio já repartido. A
+// população chega em *proxima e volta para *atual ordenada por trecho.
+static void redistribuir_agentes(Balanceamento *b, const Dominio *d,
+                                 Populacao **atual, Populacao **proxima,
+                                 MPI_Datatype tipo_agente) {
+  Populacao *p = *atual;
+
+  // origem[] é área de trabalho de ciclo; aqui guarda o novo dono
+  memset(b->contagem_envio, 0, d->size * sizeof(int));
+  for (int i = 0; i < p->n; i++) {
+    p->origem[i] = dominio_dono(d, p->gx[i], p->gy[i]);
+    b->contagem_envio[p->origem[i]]++;
+  }
+  prefixos(b->contagem_envio, b->desloc_envio, d->size);
+  buffer_reservar(&b->agentes_envio, p->n);
+
+  // contagem_recepcao serve de cursor de escrita até a troca das contagens
+  memset(b->contagem_recepcao, 0, d->size * sizeof(int));
+  for (int i = 0; i < p->n; i++) {
+    int q = p->origem[i];
+    int pos = b->desloc_envio[q] + b->contagem_recepcao[q]++;
+    populacao_empacotar(p, i, &b->agentes_envio.dados[pos]);
+  }
+
+  MPI_Alltoall(b->contagem_envio, 1, MPI_INT, b->contagem_recepcao, 1,
+               MPI_INT, d->comm);
+  int total_recepcao =
+      prefixos(b->contagem_recepcao, b->desloc_recepcao, d->size);
+  buffer_reservar(&b->agentes_recepcao, total_recepcao);
+  b->agentes_recepcao.n = total_recepcao;
+
+  MPI_Alltoallv(b->agentes_envio.dados, b->contagem_envio, b->desloc_envio,
+                tipo_agente, b->agentes_recepcao.dados, b->contagem_recepcao,
+                b->desloc_recepcao, tipo_agente, d->comm);
+
+  (*proxima)->n = 0;
+  populacao_desempacotar(*proxima, &b->agentes_recepcao, d->offsetX,
+                         d->offsetY);
+  populacao_separar_borda(*atual, *proxima, d->W_local, d->H_local);
+}
+
+int balancear(Balanceamento *b, Dominio *d, Grid *g, Populacao **atual,
+              Populacao **proxima, MPI_Datatype tipo_agente) {
+  double inicio = MPI_Wtime();
+  const Populacao *p = *atual;
+  int H = d->H_global, W = d->W_global;
+  b->n_tentativas++;
+
+  // 1. Desbalanceamento medido no intervalo que terminou
+  double tempo_max, tempo_soma;
+  MPI_Allreduce(&b->tempo_calculo, &tempo_max, 1, MPI_DOUBLE, MPI_MAX,
+                d->comm);
+  MPI_Allreduce(&b->tempo_calculo, &tempo_soma, 1, MPI_DOUBLE, MPI_SUM,
+                d->comm);
+  b->desbalanceamento_medido =
+      (tempo_soma > 0.0) ? tempo_max / (tempo_soma / d->size) : 1.0;
+
+  // 2. Peso de cada linha e coluna globais: o tempo de cada processo
+  // espalhado pelas fileiras do seu bloco segundo a estimativa de custo
+  double *linhas = b->peso, *colunas = b->peso + H;
+  for (int k = 0; k < H + W; k++) {
+    b->peso[k] = 0.0;
+  }
+  double modelo = CUSTO_CELULA * d->W_local * d->H_local;
+  for (int j = 0; j < d->H_local; j++) {
+    linhas[d->offsetY + j] = CUSTO_CELULA * d->W_local;
+  }
+  for (int i = 0; i < d->W_local; i++) {
+    colunas[d->offsetX + i] = CUSTO_CELULA * d->H_local;
+  }
+  for (int i = 0; i < p->n; i++) {
+    double c = custo_agente(b, d, g, p, i);
+    linhas[p->gy[i]] += c;
+    colunas[p->gx[i]] += c;
+    modelo += c;
+  }
+  double escala = b->tempo_calculo / modelo;
+  for (int j = 0; j < d->H_local; j++) {
+    linhas[d->offsetY + j] *= escala;
+  }
+  for (int i = 0; i < d->W_local; i++) {
+    colunas[d->offsetX + i] *= escala;
+  }
+  b->tempo_calculo = 0.0;
+
+  // Cada linha é somada sobre os processos da mesma faixa de linhas (e cada
+  // coluna sobre os da mesma faixa de colunas). O rank 0 escolhe os limites
+  // e os difunde, para que todos usem exatamente os mesmos.
+  MPI_Reduce(d->rank == 0 ? MPI_IN_PLACE : b->peso, b->peso, H + W,
+             MPI_DOUBLE, MPI_SUM, 0, d->comm);
+  if (d->rank == 0) {
+    dividir_pesos(linhas, H, d->dims[0], b->novos_limites_y);
+    dividir_pesos(colunas, W, d->dims[1], b->novos_limites_x);
+  }
+  MPI_Bcast(b->novos_limites_y, d->dims[0] + 1, MPI_INT, 0, d->comm);
+  MPI_Bcast(b->novos_limites_x, d->dims[1] + 1, MPI_INT, 0, d->comm);
+
+  // 3. Desbalanceamento estimado com os novos limites: o peso de cada agente
+  // e célula locais vai para o bloco que passaria a contê-lo. Os ranks do
+  // comunicador cartesiano seguem a ordem das linhas (coords[0] * dims[1] +
+  // coords[1]).
+  for (int q = 0; q < d->size; q++) {
+    b->peso_blocos[q] = 0.0;
+  }
+  for (int i = 0; i < p->n; i++) {
+    int by = dominio_bloco(b->novos_limites_y, d->dims[0], p->gy[i]);
+    int bx = dominio_bloco(b->novos_limites_x, d->dims[1], p->gx[i]);
+    b->peso_blocos[by * d->dims[1] + bx] += escala * custo_agente(b, d, g, p, i);
+  }
+  Retangulo meu = bloco(d, d->limites_x, d->limites_y, d->rank), r;
+  for (int q = 0; q < d->size; q++) {
+    int area = intersecao(
+        meu, bloco(d, b->novos_limites_x, b->novos_limites_y, q), &r);
+    b->peso_blocos[q] += escala * CUSTO_CELULA * area;
+  }
+  MPI_Reduce(d->rank == 0 ? MPI_IN_PLACE : b->peso_blocos, b->peso_blocos,
+             d->size, MPI_DOUBLE, MPI_SUM, 0, d->comm);
+
+  int repartir = 0;
+  if (d->rank == 0) {
+    b->desbalanceamento_estimado = desbalanceamento(b->peso_blocos, d->size);
+    int mudou = memcmp(b->novos_limites_y, d->limites_y,
+                       (d->dims[0] + 1) * sizeof(int)) != 0 ||
+                memcmp(b->novos_limites_x, d->limites_x,
+                       (d->dims[1] + 1) * sizeof(int)) != 0;
+    repartir = mudou &&
+               b->desbalanceamento_medido > LIMIAR_DESBALANCEAMENTO &&
+               b->desbalanceamento_estimado < b->desbalanceamento_medido;
+  }
+  MPI_Bcast(&repartir, 1, MPI_INT, 0, d->comm);
+
+  // 4. Repartição: grid primeiro (o empacotamento usa o bloco antigo), depois
+  // os agentes, já com os novos donos
+  if (repartir) {
+    redistribuir_grid(b, d, g);
+    redistribuir_agentes(b, d, atual, proxima, tipo_agente);
+    b->n_reparticoes++;
+  }
+
+  b->tempo_balanceamento += MPI_Wtime() - inicio;
+  return repartir;
+}
@@ -0,0 +1,60 @@
+#ifndef BALANCEAMENTO_H
+#define BALANCEAMENTO_H
+
+#include <mpi.h>
+
+#include "dominio.h"
+#include "grid.h"
+#include "pool.h"
+#include "populacao.h"
+
+// Balanceamento dinâmico de carga por repartição retilínea. O tempo de
+// cálculo medido em cada processo é espalhado pelas linhas e colunas do seu
+// bloco segundo uma estimativa de custo (cada agente pesa a carga sintética
+// da sua célula, cada célula a regeneração), somado entre processos, e os
+// limites de linhas e de colunas são movidos para que cada faixa receba o
+// mesmo peso. Células e agentes vão então para os novos donos.
+typedef struct {
+  int intervalo;        // Ciclos entre tentativas (0 = desligado)
+  int fator_carga;      // O mesmo da carga sintética, usado na estimativa
+  double tempo_calculo; // Tempo de cálculo acumulado desde a última tentativa
+
+  // Pesos globais: H_global linhas seguidas de W_global colunas
+  double *peso;
+  double *peso_blocos; // Estimativa por bloco com os limites candidatos
+  int *novos_limites_x;
+  int *novos_limites_y;
+  int *limites_antigos_x; // Cópia dos limites durante a repartição
+  int *limites_antigos_y;
+
+  // Redistribuição (uma entrada por processo)
+  int *contagem_envio, *desloc_envio;
+  int *contagem_recepcao, *desloc_recepcao;
+  double *recurso_envio, *recurso_recepcao;
+  int capacidade_recurso_envio, capacidade_recurso_recepcao;
+  BufferAgentes agentes_envio, agentes_recepcao;
+
+  // Relatório
+  int n_tentativas, n_reparticoes;
+  double tempo_balanceamento;       // Gasto nas tentativas e repartições
+  double desbalanceamento_medido;   // max/média do tempo na última tentativa
+  double desbalanceamento_estimado; // Previsto com os limites candidatos
+} Balanceamento;
+
+// Assinaturas
+void balanceamento_iniciar(Balanceamento *b, const Dominio *d, int intervalo,
+                           int fator_carga);
+void balanceamento_liberar(Balanceamento *b);
+
+// Verdadeiro se o ciclo t (a contar de 0) encerra um intervalo de medição.
+static inline int balanceamento_na_vez(const Balanceamento *b, int t) {
+  return b->intervalo > 0 && (t + 1) % b->intervalo == 0;
+}
+
+// Coletiva. Avalia o desbalanceamento do intervalo que terminou e, se valer a
+// pena, reparte o domínio e redistribui o grid e a população (que termina em
+// *atual, ordenada em [interior | borda]). Retorna 1 se houve repartição.
+int balancear(Balanceamento *b, Dominio *d, Grid *g, Populacao **atual,
+              Populacao **proxima, MPI_Datatype tipo_agente);
+
+#endif
@@ -3,6 +3,8 @@
 # Nome do executável e arquivo de saída
 EXEC="./simulacao"
 OUTPUT_FILE="resultados_benchmark.txt"
+FASES_FILE="resultados_fases.csv"  # Tempos por fase de todas as execuções
+RELATORIO="/tmp/relatorio_fases_$$.csv"
 
 # Limpa o arquivo de saída anterior
 echo "=== Benchmark: Simulação Híbrida MPI + OpenMP ===" > $OUTPUT_FILE
@@ -18,30 +20,134 @@ if [ $? -ne 0 ]; then
     exit 1
 fi
 echo "Compilação concluída com sucesso!"
+echo "grid,agentes,processos,threads,escopo,nome,min,media,max,desbalanceamento,fracao" > $FASES_FILE
 echo "Iniciando bateria de testes..."
 
 # Arrays de configuração para o teste de escalabilidade
 PROCESSOS_MPI=(1 2 4)       # Testar com 1, 2 e 4 processos MPI
 THREADS_OPENMP=(1 2 4 8)    # Testar com 1, 2, 4 e 8 threads por processo
 
-for p in "${PROCESSOS_MPI[@]}"; do
-    for t in "${THREADS_OPENMP[@]}"; do
+# Tamanhos de problema no formato LARGURAxALTURA:AGENTES. Podem ser
+# sobrescritos pela variável de ambiente TAMANHOS, por exemplo:
+#   TAMANHOS="10000x10000:20000000" CICLOS=50 ./benchmark.sh
+TAMANHOS=(${TAMANHOS:-20x20:100 200x200:10000 1000x1000:100000})
+CICLOS=${CICLOS:-100}
 
-        echo "Testando -> MPI: $p processos | OpenMP: $t threads..."
+for tam in "${TAMANHOS[@]}"; do
+    dims=${tam%%:*}
+    agentes=${tam##*:}
+    largura=${dims%%x*}
+    altura=${dims##*x}
 
-        # Configura a variável de ambiente do OpenMP
-        export OMP_NUM_THREADS=$t
+    for p in "${PROCESSOS_MPI[@]}"; do
+        for t in "${THREADS_OPENMP[@]}"; do
 
-        # Grava o cabeçalho no arquivo de saída
-        echo "" >> $OUTPUT_FILE
-        echo "[Configuração] Processos MPI: $p | Threads OpenMP: $t" >> $OUTPUT_FILE
+            echo "Testando -> Grid: ${largura}x${altura} | Agentes: $agentes | MPI: $p processos | OpenMP: $t threads..."
 
-        # Executa o programa com oversubscribe e filtra o tempo
-        mpirun --oversubscribe -np $p $EXEC | grep "Tempo total" >> $OUTPUT_FILE
+            # Configura a variável de ambiente do OpenMP
+            export OMP_NUM_THREADS=$t
 
+            # Grava o cabeçalho no arquivo de saída
+            echo "" >> $OUTPUT_FILE
+            echo "[Configuração] Grid: ${largura}x${altura} | Agentes: $agentes | Ciclos: $CICLOS | Processos MPI: $p | Threads OpenMP: $t" >> $OUTPUT_FILE
+
+            # Executa o programa em modo benchmark (sem visualização nem pausa)
+            # com oversubscribe e filtra o tempo
+            mpirun --oversubscribe -np $p $EXEC --benchmark \
+                --largura $largura --altura $altura --agentes $agentes \
+                --ciclos $CICLOS --relatorio $RELATORIO | grep "Tempo" >> $OUTPUT_FILE
+
+            # Anexa o relatório por fase desta execução, prefixado pela
+            # configuração
+            tail -n +2 $RELATORIO | sed "s/^/${largura}x${altura},$agentes,$p,$t,/" >> $FASES_FILE
+
+        done
     done
 done
 
+# Comparação das estratégias de migração no maior número de processos, com a
+# carga sintética desligada para que a troca de agentes pese no tempo total
+MIGRACOES=(pares vizinhanca sonda)
+TAM_MIGRACAO=${TAM_MIGRACAO:-1000x1000:1000000}
+dims=${TAM_MIGRACAO%%:*}
+p=${PROCESSOS_MPI[${#PROCESSOS_MPI[@]}-1]}
+export OMP_NUM_THREADS=1
+for m in "${MIGRACOES[@]}"; do
+    echo "Testando migração -> $m | MPI: $p processos..."
+    echo "" >> $OUTPUT_FILE
+    echo "[Migração] Modo: $m | Grid: $dims | Agentes: ${TAM_MIGRACAO##*:} | Processos MPI: $p" >> $OUTPUT_FILE
+    mpirun --oversubscribe -np $p $EXEC --benchmark --fator-carga 0 \
+        --largura ${dims%%x*} --altura ${dims##*x} --agentes ${TAM_MIGRACAO##*:} \
+        --ciclos $CICLOS --migracao $m | grep -E "Tempo" >> $OUTPUT_FILE
+done
+
+# A mesma migração com a memória compartilhada dentro do nó: halo e agentes
+# dos vizinhos do nó copiados direto das janelas, sem mensagens
+echo "Testando memória compartilhada | MPI: $p processos..."
+echo "" >> $OUTPUT_FILE
+echo "[Migração] Modo: vizinhanca + memoria compartilhada | Grid: $dims | Agentes: ${TAM_MIGRACAO##*:} | Processos MPI: $p" >> $OUTPUT_FILE
+mpirun --oversubscribe -np $p $EXEC --benchmark --fator-carga 0 \
+    --largura ${dims%%x*} --altura ${dims##*x} --agentes ${TAM_MIGRACAO##*:} \
+    --ciclos $CICLOS --memoria-compartilhada | grep -E "Tempo" >> $OUTPUT_FILE
+
+# Comparação dos escalonamentos da carga entre as threads no terreno
+# concentrado, onde o custo por agente é desigual, com 1 processo e o maior
+# número de threads. Além do tempo, guarda a linha "carga" (mínimo / média /
+# máximo entre as threads): quanto mais próximos, mais equilibrado.
+ESCALONAMENTOS=(tarefas custo runtime:static runtime:dynamic,256 runtime:guided)
+TAM_ESCALONAMENTO=${TAM_ESCALONAMENTO:-1000x1000:100000}
+dims=${TAM_ESCALONAMENTO%%:*}
+export OMP_NUM_THREADS=${THREADS_OPENMP[${#THREADS_OPENMP[@]}-1]}
+for e in "${ESCALONAMENTOS[@]}"; do
+    modo=${e%%:*}
+    if [ "$modo" != "$e" ]; then
+        export OMP_SCHEDULE=${e#*:}
+    fi
+    echo "Testando escalonamento -> $e | OpenMP: $OMP_NUM_THREADS threads..."
+    echo "" >> $OUTPUT_FILE
+    echo "[Escalonamento] Modo: $e | Terreno: concentrado | Grid: $dims | Agentes: ${TAM_ESCALONAMENTO##*:} | Threads OpenMP: $OMP_NUM_THREADS" >> $OUTPUT_FILE
+    mpirun --oversubscribe -np 1 $EXEC --benchmark --terreno concentrado \
+        --escalonamento $modo --largura ${dims%%x*} --altura ${dims##*x} \
+        --agentes ${TAM_ESCALONAMENTO##*:} --ciclos $CICLOS \
+        | grep -E "Tempo|^  carga" >> $OUTPUT_FILE
+done
+unset OMP_SCHEDULE
+
+# Os mesmos núcleos de um nó divididos de dois jeitos: 1 processo com N
+# threads (threads espalhadas pelos sockets, --bind-to none para o processo
+# não ficar preso a um núcleo só) contra N processos de 1 thread (um por
+# núcleo). A diferença mostra o que a memória compartilhada custa ou poupa
+# (posição das páginas entre os nós NUMA contra a troca de halos e agentes).
+N_NUCLEOS=${N_NUCLEOS:-$(nproc)}
+TAM_HIBRIDO=${TAM_HIBRIDO:-2000x2000:1000000}
+dims=${TAM_HIBRIDO%%:*}
+for combinacao in "1 $N_NUCLEOS none" "$N_NUCLEOS 1 core:overload-allowed"; do
+    set -- $combinacao
+    echo "Testando divisão do nó -> MPI: $1 processos | OpenMP: $2 threads..."
+    echo "" >> $OUTPUT_FILE
+    echo "[Nó] Processos MPI: $1 | Threads OpenMP: $2 | Afinidade: espalhada | Grid: $dims | Agentes: ${TAM_HIBRIDO##*:}" >> $OUTPUT_FILE
+    OMP_NUM_THREADS=$2 mpirun --oversubscribe --bind-to $3 -np $1 $EXEC \
+        --benchmark --afinidade espalhada --largura ${dims%%x*} \
+        --altura ${dims##*x} --agentes ${TAM_HIBRIDO##*:} --ciclos $CICLOS \
+        | grep -E "Tempo|Atualizacoes" >> $OUTPUT_FILE
+done
+
+# Grid grande e pouco ocupado: a regeneração completa percorre todas as
+# células a cada ciclo, a adiada só as consumidas
+TAM_ESPARSO=${TAM_ESPARSO:-3000x3000:20000}
+dims=${TAM_ESPARSO%%:*}
+export OMP_NUM_THREADS=${THREADS_OPENMP[${#THREADS_OPENMP[@]}-1]}
+for modo in completa adiada; do
+    echo "Testando regeneração -> $modo | OpenMP: $OMP_NUM_THREADS threads..."
+    echo "" >> $OUTPUT_FILE
+    echo "[Regeneração] Modo: $modo | Grid: $dims | Agentes: ${TAM_ESPARSO##*:} | Threads OpenMP: $OMP_NUM_THREADS" >> $OUTPUT_FILE
+    mpirun --oversubscribe -np 1 $EXEC --benchmark --regeneracao $modo \
+        --fator-carga 0 --largura ${dims%%x*} --altura ${dims##*x} \
+        --agentes ${TAM_ESPARSO##*:} --ciclos $CICLOS \
+        | grep -E "Tempo|Checksum" >> $OUTPUT_FILE
+done
+
 echo "-------------------------------------------------" >> $OUTPUT_FILE
-echo "Bateria de testes concluída. Resultados salvos em $OUTPUT_FILE."
+rm -f $RELATORIO
+echo "Bateria de testes concluída. Resultados salvos em $OUTPUT_FILE e $FASES_FILE."
 cat $OUTPUT_FILE
@@ -0,0 +1,262 @@
+#include "checkpoint.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void checkpoint_iniciar(Checkpoint *c) {
+  MPI_Type_contiguous(sizeof(RegistroCheckpoint), MPI_BYTE, &c->tipo_registro);
+  MPI_Type_commit(&c->tipo_registro);
+  c->registros = NULL;
+  c->capacidade = 0;
+  c->n_gravados = 0;
+  c->bytes = 0;
+  c->tempo = 0.0;
+}
+
+void checkpoint_liberar(Checkpoint *c) {
+  MPI_Type_free(&c->tipo_registro);
+  free(c->registros);
+}
+
+static void reservar_registros(Checkpoint *c, int n) {
+  if (n <= c->capacidade) {
+    return;
+  }
+  c->registros = (RegistroCheckpoint *)realloc(
+      c->registros, n * sizeof(RegistroCheckpoint));
+  if (c->registros == NULL) {
+    printf("Erro fatal de memoria no checkpoint (%d agentes)!\n", n);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  c->capacidade = n;
+}
+
+// Início do trecho de agentes: logo depois do grid global.
+static MPI_Offset inicio_agentes(int largura, int altura) {
+  return CHECKPOINT_CABECALHO + (MPI_Offset)largura * altura * sizeof(double);
+}
+
+// Tipos do bloco local: no arquivo, o retângulo do bloco dentro do grid
+// global; na memória, o interior do plano com halo.
+static void tipos_bloco(const Dominio *d, MPI_Datatype *arquivo,
+                        MPI_Datatype *memoria) {
+  int global[2] = {d->H_global, d->W_global};
+  int com_halo[2] = {d->H_local + 2, d->W_local + 2};
+  int local[2] = {d->H_local, d->W_local};
+  int offset[2] = {d->offsetY, d->offsetX};
+  int interior[2] = {1, 1};
+  MPI_Type_create_subarray(2, global, local, offset, MPI_ORDER_C, MPI_DOUBLE,
+                           arquivo);
+  MPI_Type_create_subarray(2, com_halo, local, interior, MPI_ORDER_C,
+                           MPI_DOUBLE, memoria);
+  MPI_Type_commit(arquivo);
+  MPI_Type_commit(memoria);
+}
+
+static void abrir(const char *arquivo, MPI_Comm comm, int modo,
+                  MPI_File *fh) {
+  if (MPI_File_open(comm, arquivo, modo, MPI_INFO_NULL, fh) != MPI_SUCCESS) {
+    printf("Erro ao abrir o checkpoint %s\n", arquivo);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+}
+
+int checkpoint_ler_cabecalho(const char *arquivo, MPI_Comm comm,
+                             CabecalhoCheckpoint *cab) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  int ok = 0;
+  if (rank == 0) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_SELF, arquivo, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                      &fh) != MPI_SUCCESS) {
+      printf("Erro ao abrir o checkpoint %s\n", arquivo);
+    } else {
+      MPI_Offset tamanho;
+      MPI_File_get_size(fh, &tamanho);
+      memset(cab, 0, sizeof(*cab));
+      if (tamanho >= CHECKPOINT_CABECALHO) {
+        MPI_File_read_at(fh, 0, cab, sizeof(*cab), MPI_BYTE,
+                         MPI_STATUS_IGNORE);
+      }
+      MPI_File_close(&fh);
+
+      ok = memcmp(cab->assinatura, CHECKPOINT_ASSINATURA, 8) == 0 &&
+           cab->tamanho_registro == sizeof(RegistroCheckpoint) &&
+           cab->largura > 0 && cab->altura > 0 && cab->ciclo >= 0 &&
+           cab->n_agentes >= 0 && cab->n_agentes <= INT_MAX &&
+           tamanho == inicio_agentes(cab->largura, cab->altura) +
+                          cab->n_agentes * (MPI_Offset)sizeof(RegistroCheckpoint);
+      if (!ok) {
+        printf("%s nao e um checkpoint valido (ou esta incompleto)\n",
+               arquivo);
+      }
+    }
+  }
+
+  MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+  MPI_Bcast(cab, sizeof(*cab), MPI_BYTE, 0, comm);
+  return ok ? 0 : -1;
+}
+
+void checkpoint_gravar(Checkpoint *c, const char *arquivo, const Dominio *d,
+                       const Grid *g, const Populacao *p, int ciclo,
+                       int estacao, unsigned int semente) {
+  double inicio = MPI_Wtime();
+  char temporario[300];
+  snprintf(temporario, sizeof(temporario), "%s.tmp", arquivo);
+
+  // Posição dos agentes deste processo no trecho de agentes
+  long long n_local = p->n, antes = 0, total = 0;
+  MPI_Exscan(&n_local, &antes, 1, MPI_LONG_LONG, MPI_SUM, d->comm);
+  MPI_Allreduce(&n_local, &total, 1, MPI_LONG_LONG, MPI_SUM, d->comm);
+  if (d->rank == 0) {
+    antes = 0; // MPI_Exscan não define o valor no rank 0
+  }
+
+  MPI_File fh;
+  abrir(temporario, d->comm, MPI_MODE_CREATE | MPI_MODE_WRONLY, &fh);
+  MPI_File_set_size(fh, 0); // Descarta restos de uma gravação interrompida
+
+  if (d->rank == 0) {
+    char bloco[CHECKPOINT_CABECALHO];
+    CabecalhoCheckpoint cab;
+    memset(bloco, 0, sizeof(bloco));
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.assinatura, CHECKPOINT_ASSINATURA, 8);
+    cab.tamanho_registro = sizeof(RegistroCheckpoint);
+    cab.largura = d->W_global;
+    cab.altura = d->H_global;
+    cab.ciclo = ciclo;
+    cab.estacao = estacao;
+    cab.semente = semente;
+    cab.n_agentes = total;
+    memcpy(bloco, &cab, sizeof(cab));
+    MPI_File_write_at(fh, 0, bloco, CHECKPOINT_CABECALHO, MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  }
+
+  // Grid: cada processo grava o seu retângulo numa só escrita coletiva
+  MPI_Datatype tipo_arquivo, tipo_memoria;
+  tipos_bloco(d, &tipo_arquivo, &tipo_memoria);
+  MPI_File_set_view(fh, CHECKPOINT_CABECALHO, MPI_DOUBLE, tipo_arquivo,
+                    "native", MPI_INFO_NULL);
+  MPI_File_write_all(fh, g->recurso, 1, tipo_memoria, MPI_STATUS_IGNORE);
+  MPI_Type_free(&tipo_arquivo);
+  MPI_Type_free(&tipo_memoria);
+
+  // Agentes: trechos contíguos, na ordem dos ranks
+  reservar_registros(c, p->n);
+  for (int i = 0; i < p->n; i++) {
+    c->registros[i].gx = p->gx[i];
+    c->registros[i].gy = p->gy[i];
+    c->registros[i].energia = p->energia[i];
+    c->registros[i].id = p->id[i];
+  }
+  MPI_File_set_view(fh, inicio_agentes(d->W_global, d->H_global),
+                    c->tipo_registro, c->tipo_registro, "native",
+                    MPI_INFO_NULL);
+  MPI_File_write_at_all(fh, antes, c->registros, p->n, c->tipo_registro,
+                        MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
+
+  // Só um arquivo completo toma o lugar do checkpoint anterior
+  int ok = 1;
+  if (d->rank == 0 && rename(temporario, arquivo) != 0) {
+    printf("Erro ao renomear %s para %s\n", temporario, arquivo);
+    ok = 0;
+  }
+  MPI_Bcast(&ok, 1, MPI_INT, 0, d->comm);
+  if (!ok) {
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  c->n_gravados++;
+  c->bytes += inicio_agentes(d->W_global, d->H_global) +
+              total * (long long)sizeof(RegistroCheckpoint);
+  c->tempo += MPI_Wtime() - inicio;
+}
+
+static int prefixos(const int *contagem, int *desloc, int n) {
+  int total = 0;
+  for (int k = 0; k < n; k++) {
+    desloc[k] = total;
+    total += contagem[k];
+  }
+  return total;
+}
+
+void checkpoint_carregar(Checkpoint *c, const char *arquivo,
+                         const CabecalhoCheckpoint *cab, const Dominio *d,
+                         Grid *g, Populacao *atual, Populacao *proxima,
+                         MPI_Datatype tipo_agente) {
+  MPI_File fh;
+  abrir(arquivo, d->comm, MPI_MODE_RDONLY, &fh);
+
+  // Grid: a mesma vista da gravação, agora sobre a decomposição atual
+  MPI_Datatype tipo_arquivo, tipo_memoria;
+  tipos_bloco(d, &tipo_arquivo, &tipo_memoria);
+  MPI_File_set_view(fh, CHECKPOINT_CABECALHO, MPI_DOUBLE, tipo_arquivo,
+                    "native", MPI_INFO_NULL);
+  MPI_File_read_all(fh, g->recurso, 1, tipo_memoria, MPI_STATUS_IGNORE);
+  MPI_Type_free(&tipo_arquivo);
+  MPI_Type_free(&tipo_memoria);
+
+  // Agentes: cada processo lê uma fatia igual do trecho, sem saber ainda a
+  // quem pertencem
+  int ini, fim;
+  populacao_faixa((int)cab->n_agentes, d->size, d->rank, &ini, &fim);
+  int n = fim - ini;
+  reservar_registros(c, n);
+  MPI_File_set_view(fh, inicio_agentes(cab->largura, cab->altura),
+                    c->tipo_registro, c->tipo_registro, "native",
+                    MPI_INFO_NULL);
+  MPI_File_read_at_all(fh, ini, c->registros, n, c->tipo_registro,
+                       MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
+
+  // Envia cada agente ao dono da sua posição (agrupados por destino)
+  int *contagem_envio = (int *)calloc(4 * d->size, sizeof(int));
+  int *desloc_envio = contagem_envio + d->size;
+  int *contagem_recepcao = desloc_envio + d->size;
+  int *desloc_recepcao = contagem_recepcao + d->size;
+  int *dono = (int *)malloc((n > 0 ? n : 1) * sizeof(int));
+  for (int k = 0; k < n; k++) {
+    dono[k] = dominio_dono(d, c->registros[k].gx, c->registros[k].gy);
+    contagem_envio[dono[k]]++;
+  }
+  prefixos(contagem_envio, desloc_envio, d->size);
+
+  BufferAgentes envio, recebidos;
+  buffer_iniciar(&envio, n > 0 ? n : 1);
+  for (int k = 0; k < n; k++) {
+    Agente a = {0};
+    a.gx = c->registros[k].gx;
+    a.gy = c->registros[k].gy;
+    a.energia = c->registros[k].energia;
+    a.id = c->registros[k].id;
+    // contagem_recepcao serve de cursor de escrita até a troca das contagens
+    envio.dados[desloc_envio[dono[k]] + contagem_recepcao[dono[k]]++] = a;
+  }
+  envio.n = n;
+
+  MPI_Alltoall(contagem_envio, 1, MPI_INT, contagem_recepcao, 1, MPI_INT,
+               d->comm);
+  int total_recepcao = prefixos(contagem_recepcao, desloc_recepcao, d->size);
+  buffer_iniciar(&recebidos, total_recepcao > 0 ? total_recepcao : 1);
+  recebidos.n = total_recepcao;
+  MPI_Alltoallv(envio.dados, contagem_envio, desloc_envio, tipo_agente,
+                recebidos.dados, contagem_recepcao, desloc_recepcao,
+                tipo_agente, d->comm);
+
+  proxima->n = 0;
+  populacao_desempacotar(proxima, &recebidos, d->offsetX, d->offsetY);
+  populacao_separar_borda(atual, proxima, d->W_local, d->H_local);
+
+  buffer_liberar(&envio);
+  buffer_liberar(&recebidos);
+  free(dono);
+  free(contagem_envio);
+}
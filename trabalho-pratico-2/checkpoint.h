@@ -0,0 +1,75 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <mpi.h>
+#include <stdint.h>
+
+#include "dominio.h"
+#include "grid.h"
+#include "populacao.h"
+
+// Checkpoint do estado completo num único arquivo, compartilhado por todos os
+// processos e gravado com MPI-IO:
+//
+//   [cabeçalho]  CHECKPOINT_CABECALHO bytes (CabecalhoCheckpoint + zeros)
+//   [grid]       recurso do grid global, W x H doubles em ordem de linhas
+//   [agentes]    n_agentes registros RegistroCheckpoint
+//
+// Nada no arquivo depende da decomposição, então ele pode ser lido com outro
+// número de processos. Inteiros e doubles ficam na representação nativa.
+#define CHECKPOINT_CABECALHO 64
+#define CHECKPOINT_ASSINATURA "SIMCKP01"
+
+typedef struct {
+  char assinatura[8];
+  uint32_t tamanho_registro; // sizeof(RegistroCheckpoint), confere o formato
+  int32_t largura, altura;
+  int32_t ciclo;   // Próximo ciclo a simular
+  int32_t estacao; // Estação ao fim do último ciclo simulado
+  uint32_t semente;
+  int64_t n_agentes;
+} CabecalhoCheckpoint;
+
+typedef struct {
+  int32_t gx, gy;
+  double energia;
+  uint64_t id;
+} RegistroCheckpoint;
+
+// Área de trabalho e custo acumulado dos checkpoints deste processo.
+typedef struct {
+  MPI_Datatype tipo_registro;
+  RegistroCheckpoint *registros;
+  int capacidade;
+
+  int n_gravados;
+  long long bytes; // Soma dos tamanhos dos arquivos gravados
+  double tempo;    // Gravação, da abertura ao arquivo renomeado
+} Checkpoint;
+
+// Assinaturas
+void checkpoint_iniciar(Checkpoint *c);
+void checkpoint_liberar(Checkpoint *c);
+
+// Coletiva. O rank 0 lê e confere o cabeçalho e o difunde. Retorna 0 em caso
+// de sucesso (e -1, com a mensagem já impressa, se o arquivo não servir).
+int checkpoint_ler_cabecalho(const char *arquivo, MPI_Comm comm,
+                             CabecalhoCheckpoint *cab);
+
+// Coletiva. Grava o estado ao fim de um ciclo (ciclo = o próximo a simular)
+// em "<arquivo>.tmp" e o renomeia ao final, para que uma interrupção no meio
+// da escrita não estrague o último checkpoint completo.
+void checkpoint_gravar(Checkpoint *c, const char *arquivo, const Dominio *d,
+                       const Grid *g, const Populacao *p, int ciclo,
+                       int estacao, unsigned int semente);
+
+// Coletiva. Lê o recurso do bloco local (o grid já preenchido com os tipos) e
+// a população: cada processo lê um trecho contíguo dos agentes e os envia ao
+// dono da posição. A população termina em *atual, ordenada em
+// [interior | borda].
+void checkpoint_carregar(Checkpoint *c, const char *arquivo,
+                         const CabecalhoCheckpoint *cab, const Dominio *d,
+                         Grid *g, Populacao *atual, Populacao *proxima,
+                         MPI_Datatype tipo_agente);
+
+#endif
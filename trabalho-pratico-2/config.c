@@ -0,0 +1,461 @@
+#include "config.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  OP_LARGURA = 'W',
+  OP_ALTURA = 'H',
+  OP_AGENTES = 'n',
+  OP_CICLOS = 't',
+  OP_ESTACAO = 's',
+  OP_SEMENTE = 'S',
+  OP_CONFIG = 'c',
+  OP_BENCHMARK = 'b',
+  OP_VISUALIZAR = 'v',
+  OP_TAXA_SECA = 256,
+  OP_TAXA_CHEIA,
+  OP_CONSUMO,
+  OP_REPRODUCAO,
+  OP_PROCS_X,
+  OP_PROCS_Y,
+  OP_FATOR_CARGA,
+  OP_ESCALONAMENTO,
+  OP_TERRENO,
+  OP_REGENERACAO,
+  OP_AFINIDADE,
+  OP_MIGRACAO,
+  OP_COMPARTILHADA,
+  OP_REBALANCEAR,
+  OP_REORDENAR,
+  OP_METRICAS,
+  OP_LOG_FORMATO,
+  OP_LOG_DESCARGA,
+  OP_RELATORIO,
+  OP_CHECKPOINT_CADA,
+  OP_CHECKPOINT,
+  OP_REINICIAR,
+  OP_SNAPSHOT,
+  OP_SNAPSHOT_CADA,
+  OP_SNAPSHOT_REDUCAO,
+  OP_DIFERENCAS,
+  OP_VISUALIZACAO,
+};
+
+static struct option opcoes[] = {
+    {"largura", required_argument, NULL, OP_LARGURA},
+    {"altura", required_argument, NULL, OP_ALTURA},
+    {"agentes", required_argument, NULL, OP_AGENTES},
+    {"ciclos", required_argument, NULL, OP_CICLOS},
+    {"ciclos-estacao", required_argument, NULL, OP_ESTACAO},
+    {"semente", required_argument, NULL, OP_SEMENTE},
+    {"taxa-seca", required_argument, NULL, OP_TAXA_SECA},
+    {"taxa-cheia", required_argument, NULL, OP_TAXA_CHEIA},
+    {"consumo", required_argument, NULL, OP_CONSUMO},
+    {"energia-reproducao", required_argument, NULL, OP_REPRODUCAO},
+    {"fator-carga", required_argument, NULL, OP_FATOR_CARGA},
+    {"escalonamento", required_argument, NULL, OP_ESCALONAMENTO},
+    {"terreno", required_argument, NULL, OP_TERRENO},
+    {"regeneracao", required_argument, NULL, OP_REGENERACAO},
+    {"afinidade", required_argument, NULL, OP_AFINIDADE},
+    {"procs-x", required_argument, NULL, OP_PROCS_X},
+    {"procs-y", required_argument, NULL, OP_PROCS_Y},
+    {"migracao", required_argument, NULL, OP_MIGRACAO},
+    {"memoria-compartilhada", no_argument, NULL, OP_COMPARTILHADA},
+    {"rebalancear-cada", required_argument, NULL, OP_REBALANCEAR},
+    {"reordenar-cada", required_argument, NULL, OP_REORDENAR},
+    {"metricas-cada", required_argument, NULL, OP_METRICAS},
+    {"log-formato", required_argument, NULL, OP_LOG_FORMATO},
+    {"log-descarga", required_argument, NULL, OP_LOG_DESCARGA},
+    {"relatorio", required_argument, NULL, OP_RELATORIO},
+    {"checkpoint-cada", required_argument, NULL, OP_CHECKPOINT_CADA},
+    {"checkpoint", required_argument, NULL, OP_CHECKPOINT},
+    {"reiniciar", required_argument, NULL, OP_REINICIAR},
+    {"snapshot", required_argument, NULL, OP_SNAPSHOT},
+    {"snapshot-cada", required_argument, NULL, OP_SNAPSHOT_CADA},
+    {"snapshot-reducao", required_argument, NULL, OP_SNAPSHOT_REDUCAO},
+    {"config", required_argument, NULL, OP_CONFIG},
+    {"benchmark", no_argument, NULL, OP_BENCHMARK},
+    {"visualizar-cada", required_argument, NULL, OP_VISUALIZAR},
+    {"visualizacao", required_argument, NULL, OP_VISUALIZACAO},
+    {"visualizar-diferencas", no_argument, NULL, OP_DIFERENCAS},
+    {NULL, 0, NULL, 0}};
+
+static const char *opcoes_curtas = "W:H:n:t:s:S:c:bv:";
+
+void config_padrao(Config *cfg) {
+  cfg->largura = 20;
+  cfg->altura = 20;
+  cfg->n_agentes = 100;
+  cfg->ciclos = 100;
+  cfg->ciclos_estacao = 10;
+  cfg->semente = 42;
+  cfg->taxa_seca = 1.5;
+  cfg->taxa_cheia = 3.0;
+  cfg->consumo = 2.0;
+  cfg->energia_reproducao = 0.0; // Sem reprodução
+  cfg->fator_carga = 1000;
+  cfg->escalonamento = ESCALONAMENTO_TAREFAS;
+  cfg->terreno = TERRENO_MISTO;
+  cfg->regeneracao = REGENERACAO_COMPLETA;
+  cfg->afinidade = AFINIDADE_ESPALHADA;
+  cfg->procs_x = 0;
+  cfg->procs_y = 0;
+  cfg->migracao = MIGRACAO_VIZINHANCA;
+  cfg->memoria_compartilhada = 0;
+  cfg->rebalancear_cada = 20;
+  cfg->reordenar_cada = 10;
+  cfg->metricas_cada = 1;
+  cfg->log_formato = LOG_TEXTO;
+  cfg->log_descarga = 64;
+  cfg->visualizar_cada = 1; // Animação a cada ciclo
+  cfg->visualizacao = VIS_TERRENO;
+  cfg->visualizar_diferencas = 0;
+  cfg->relatorio[0] = '\0';
+  cfg->checkpoint_cada = 0;
+  snprintf(cfg->checkpoint, sizeof(cfg->checkpoint), "simulacao.ckpt");
+  cfg->reiniciar[0] = '\0';
+  cfg->snapshot[0] = '\0';
+  cfg->snapshot_cada = 1;
+  cfg->snapshot_reducao = 1;
+}
+
+// Aplica um par opção/valor já identificado. Retorna 0 em caso de sucesso.
+static int aplicar(Config *cfg, int op, const char *valor) {
+  switch (op) {
+  case OP_LARGURA:
+    cfg->largura = atoi(valor);
+    break;
+  case OP_ALTURA:
+    cfg->altura = atoi(valor);
+    break;
+  case OP_AGENTES:
+    cfg->n_agentes = atoi(valor);
+    break;
+  case OP_CICLOS:
+    cfg->ciclos = atoi(valor);
+    break;
+  case OP_ESTACAO:
+    cfg->ciclos_estacao = atoi(valor);
+    break;
+  case OP_SEMENTE:
+    cfg->semente = (unsigned int)strtoul(valor, NULL, 10);
+    break;
+  case OP_TAXA_SECA:
+    cfg->taxa_seca = atof(valor);
+    break;
+  case OP_TAXA_CHEIA:
+    cfg->taxa_cheia = atof(valor);
+    break;
+  case OP_CONSUMO:
+    cfg->consumo = atof(valor);
+    break;
+  case OP_REPRODUCAO:
+    cfg->energia_reproducao = atof(valor);
+    break;
+  case OP_FATOR_CARGA:
+    cfg->fator_carga = atoi(valor);
+    break;
+  case OP_ESCALONAMENTO:
+    if (populacao_escalonamento_de(valor, &cfg->escalonamento) != 0) {
+      fprintf(stderr, "Escalonamento desconhecido: %s\n", valor);
+      return -1;
+    }
+    break;
+  case OP_TERRENO:
+    if (grid_terreno_de(valor, &cfg->terreno) != 0) {
+      fprintf(stderr, "Terreno desconhecido: %s\n", valor);
+      return -1;
+    }
+    break;
+  case OP_REGENERACAO:
+    if (grid_regeneracao_de(valor, &cfg->regeneracao) != 0) {
+      fprintf(stderr, "Regeneracao desconhecida: %s\n", valor);
+      return -1;
+    }
+    break;
+  case OP_AFINIDADE:
+    if (numa_afinidade_de(valor, &cfg->afinidade) != 0) {
+      fprintf(stderr, "Afinidade desconhecida: %s\n", valor);
+      return -1;
+    }
+    break;
+  case OP_PROCS_X:
+    cfg->procs_x = atoi(valor);
+    break;
+  case OP_PROCS_Y:
+    cfg->procs_y = atoi(valor);
+    break;
+  case OP_MIGRACAO:
+    if (migracao_modo_de(valor, &cfg->migracao) != 0) {
+      fprintf(stderr, "Modo de migracao desconhecido: %s\n", valor);
+      return -1;
+    }
+    break;
+  case OP_COMPARTILHADA:
+    cfg->memoria_compartilhada = 1;
+    break;
+  case OP_REBALANCEAR:
+    cfg->rebalancear_cada = atoi(valor);
+    break;
+  case OP_REORDENAR:
+    cfg->reordenar_cada = atoi(valor);
+    break;
+  case OP_METRICAS:
+    cfg->metricas_cada = atoi(valor);
+    break;
+  case OP_LOG_FORMATO:
+    if (logger_formato_de(valor, &cfg->log_formato) != 0) {
+      fprintf(stderr, "Formato de log desconhecido: %s\n", valor);
+      return -1;
+    }
+    break;
+  case OP_LOG_DESCARGA:
+    cfg->log_descarga = atoi(valor);
+    break;
+  case OP_RELATORIO:
+    snprintf(cfg->relatorio, sizeof(cfg->relatorio), "%s", valor);
+    break;
+  case OP_CHECKPOINT_CADA:
+    cfg->checkpoint_cada = atoi(valor);
+    break;
+  case OP_CHECKPOINT:
+    snprintf(cfg->checkpoint, sizeof(cfg->checkpoint), "%s", valor);
+    break;
+  case OP_REINICIAR:
+    snprintf(cfg->reiniciar, sizeof(cfg->reiniciar), "%s", valor);
+    break;
+  case OP_SNAPSHOT:
+    snprintf(cfg->snapshot, sizeof(cfg->snapshot), "%s", valor);
+    break;
+  case OP_SNAPSHOT_CADA:
+    cfg->snapshot_cada = atoi(valor);
+    break;
+  case OP_SNAPSHOT_REDUCAO:
+    cfg->snapshot_reducao = atoi(valor);
+    break;
+  case OP_VISUALIZACAO:
+    if (visualizacao_modo_de(valor, &cfg->visualizacao) != 0) {
+      fprintf(stderr, "Modo de visualizacao desconhecido: %s\n", valor);
+      return -1;
+    }
+    break;
+  case OP_BENCHMARK:
+    cfg->visualizar_cada = 0;
+    break;
+  case OP_DIFERENCAS:
+    cfg->visualizar_diferencas = 1;
+    break;
+  case OP_VISUALIZAR:
+    cfg->visualizar_cada = atoi(valor);
+    break;
+  default:
+    return -1;
+  }
+  return 0;
+}
+
+static int validar(const Config *cfg) {
+  if (cfg->largura <= 0 || cfg->altura <= 0 || cfg->n_agentes < 0 ||
+      cfg->ciclos < 0 || cfg->ciclos_estacao <= 0 ||
+      cfg->visualizar_cada < 0 || cfg->consumo < 0.0 ||
+      cfg->energia_reproducao < 0.0 ||
+      cfg->fator_carga < 0 || cfg->procs_x < 0 || cfg->procs_y < 0 ||
+      cfg->rebalancear_cada < 0 || cfg->reordenar_cada < 0 ||
+      cfg->metricas_cada <= 0 ||
+      cfg->log_descarga <= 0 || cfg->checkpoint_cada < 0 ||
+      cfg->checkpoint[0] == '\0' || cfg->snapshot_cada <= 0 ||
+      cfg->snapshot_reducao <= 0) {
+    fprintf(stderr, "Parametros invalidos na configuracao.\n");
+    return -1;
+  }
+  // A forma fechada supõe que o recurso só cresce entre dois consumos
+  if (cfg->regeneracao == REGENERACAO_ADIADA &&
+      (cfg->taxa_seca < 0.0 || cfg->taxa_cheia < 0.0)) {
+    fprintf(stderr, "A regeneracao adiada exige taxas nao negativas.\n");
+    return -1;
+  }
+  return 0;
+}
+
+// Formato do arquivo: uma "chave = valor" por linha, com as mesmas chaves das
+// opções longas (ex.: "largura = 10000"). Linhas iniciadas por '#' são
+// comentários.
+int config_ler_arquivo(Config *cfg, const char *nome_arquivo) {
+  FILE *f = fopen(nome_arquivo, "r");
+  if (f == NULL) {
+    fprintf(stderr, "Erro ao abrir o arquivo de configuracao %s\n",
+            nome_arquivo);
+    return -1;
+  }
+
+  char linha[256];
+  int num_linha = 0;
+  while (fgets(linha, sizeof(linha), f) != NULL) {
+    num_linha++;
+    char chave[64], valor[128];
+    char *p = linha;
+    while (*p == ' ' || *p == '\t')
+      p++;
+    if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+      continue;
+    if (sscanf(p, " %63[^= \t] = %127s", chave, valor) != 2) {
+      fprintf(stderr, "%s:%d: linha invalida\n", nome_arquivo, num_linha);
+      fclose(f);
+      return -1;
+    }
+
+    int op = -1;
+    for (int i = 0; opcoes[i].name != NULL; i++) {
+      if (strcmp(opcoes[i].name, chave) == 0) {
+        op = opcoes[i].val;
+        break;
+      }
+    }
+    // Não fazem sentido dentro do arquivo (a afinidade é aplicada antes de
+    // ele ser lido)
+    if (op == OP_CONFIG || op == OP_BENCHMARK || op == OP_DIFERENCAS ||
+        op == OP_COMPARTILHADA || op == OP_AFINIDADE) {
+      op = -1;
+    }
+    if (aplicar(cfg, op, valor) != 0) {
+      fprintf(stderr, "%s:%d: chave desconhecida '%s'\n", nome_arquivo,
+              num_linha, chave);
+      fclose(f);
+      return -1;
+    }
+  }
+  fclose(f);
+  return validar(cfg);
+}
+
+// O arquivo indicado por --config é lido primeiro; as demais opções da linha
+// de comando sobrescrevem os valores dele, independentemente da ordem.
+int config_ler_argumentos(Config *cfg, int argc, char **argv) {
+  int op;
+
+  opterr = 0;
+  optind = 1;
+  while ((op = getopt_long(argc, argv, opcoes_curtas, opcoes, NULL)) != -1) {
+    if (op == OP_CONFIG && config_ler_arquivo(cfg, optarg) != 0) {
+      return -1;
+    }
+  }
+
+  opterr = 1;
+  optind = 1;
+  while ((op = getopt_long(argc, argv, opcoes_curtas, opcoes, NULL)) != -1) {
+    if (op == OP_CONFIG)
+      continue;
+    if (aplicar(cfg, op, optarg) != 0) {
+      return -1;
+    }
+  }
+  if (optind < argc) {
+    fprintf(stderr, "Argumento inesperado: %s\n", argv[optind]);
+    return -1;
+  }
+  return validar(cfg);
+}
+
+void config_imprimir_uso(const char *programa) {
+  fprintf(stderr,
+          "Uso: %s [opcoes]\n"
+          "  -W, --largura N          largura do grid global (20)\n"
+          "  -H, --altura N           altura do grid global (20)\n"
+          "  -n, --agentes N          total de agentes iniciais (100)\n"
+          "  -t, --ciclos N           ciclos de simulacao (100)\n"
+          "  -s, --ciclos-estacao N   ciclos por estacao (10)\n"
+          "  -S, --semente N          semente aleatoria (42)\n"
+          "      --taxa-seca X        regeneracao por ciclo na SECA (1.5)\n"
+          "      --taxa-cheia X       regeneracao por ciclo na CHEIA (3.0)\n"
+          "      --consumo X          consumo de recurso por agente (2.0)\n"
+          "      --energia-reproducao X  energia a partir da qual o agente "
+          "se divide (0 = nunca)\n"
+          "      --fator-carga N      iteracoes de carga por unidade de "
+          "recurso (1000)\n"
+          "      --escalonamento MODO tarefas | runtime | custo, reparticao "
+          "da carga entre as threads (tarefas)\n"
+          "      --terreno MODO       misto | concentrado (misto)\n"
+          "      --regeneracao MODO   completa | adiada, regenera o grid "
+          "inteiro ou so as celulas visitadas (completa)\n"
+          "      --afinidade MODO     nenhuma | proxima | espalhada, "
+          "fixacao das threads (espalhada)\n"
+          "      --procs-x N          processos no eixo X (0 = automatico)\n"
+          "      --procs-y N          processos no eixo Y (0 = automatico)\n"
+          "      --migracao MODO      pares | vizinhanca | sonda "
+          "(vizinhanca)\n"
+          "      --memoria-compartilhada  halo e agentes pela memoria entre "
+          "processos do mesmo no\n"
+          "      --rebalancear-cada N rebalanceia a carga a cada N ciclos "
+          "(20, 0 = nunca)\n"
+          "      --reordenar-cada N   reordena os agentes pela curva de "
+          "Morton a cada N ciclos (10, 0 = nunca)\n"
+          "      --metricas-cada N    amostra as metricas globais a cada N "
+          "ciclos (1)\n"
+          "      --log-formato F      texto | csv | binario | nenhum "
+          "(texto)\n"
+          "      --log-descarga N     registros de log por escrita em disco "
+          "(64)\n"
+          "      --relatorio ARQUIVO  tempos por fase em CSV (ou JSON, se "
+          "terminar em .json)\n"
+          "      --checkpoint-cada N  grava um checkpoint a cada N ciclos "
+          "(0 = nunca)\n"
+          "      --checkpoint ARQUIVO arquivo de checkpoint "
+          "(simulacao.ckpt)\n"
+          "      --reiniciar ARQUIVO  retoma a simulacao de um checkpoint\n"
+          "      --snapshot ARQUIVO   grava quadros binarios do grid e dos "
+          "agentes\n"
+          "      --snapshot-cada N    um quadro a cada N ciclos (1)\n"
+          "      --snapshot-reducao N amostra celulas e ids multiplos de N "
+          "(1)\n"
+          "  -c, --config ARQUIVO     le 'chave = valor' de um arquivo\n"
+          "  -b, --benchmark          executa sem visualizacao e sem pausa\n"
+          "  -v, --visualizar-cada N  desenha o grid a cada N ciclos "
+          "(0 = nunca)\n"
+          "      --visualizacao MODO  terreno | densidade (terreno)\n"
+          "      --visualizar-diferencas  redesenha so as celulas que "
+          "mudaram\n",
+          programa);
+}
+
+void config_imprimir(const Config *cfg) {
+  printf("Configuracao: grid %dx%d | agentes %d | ciclos %d | estacao %d | "
+         "semente %u\n",
+         cfg->largura, cfg->altura, cfg->n_agentes, cfg->ciclos,
+         cfg->ciclos_estacao, cfg->semente);
+  printf("              taxa SECA %.2f | taxa CHEIA %.2f | consumo %.2f | "
+         "fator de carga %d | visualizar a cada %d\n",
+         cfg->taxa_seca, cfg->taxa_cheia, cfg->consumo, cfg->fator_carga,
+         cfg->visualizar_cada);
+  printf("              escalonamento %s | terreno %s | regeneracao %s\n",
+         populacao_escalonamento_nome(cfg->escalonamento),
+         grid_terreno_nome(cfg->terreno),
+         grid_regeneracao_nome(cfg->regeneracao));
+  const char *bind = getenv("OMP_PROC_BIND");
+  const char *places = getenv("OMP_PLACES");
+  printf("              afinidade %s | OMP_PROC_BIND=%s | OMP_PLACES=%s\n",
+         numa_afinidade_nome(cfg->afinidade), bind != NULL ? bind : "-",
+         places != NULL ? places : "-");
+  if (cfg->energia_reproducao > 0.0) {
+    printf("              reproducao com energia %.2f\n",
+           cfg->energia_reproducao);
+  }
+  printf("              migracao %s%s | rebalancear a cada %d | reordenar "
+         "a cada %d | metricas a cada %d | log %s\n",
+         migracao_nome(cfg->migracao),
+         cfg->memoria_compartilhada ? " (memoria compartilhada no no)" : "",
+         cfg->rebalancear_cada,
+         cfg->reordenar_cada, cfg->metricas_cada,
+         logger_nome_formato(cfg->log_formato));
+  if (cfg->checkpoint_cada > 0 || cfg->reiniciar[0] != '\0') {
+    printf("              checkpoint a cada %d em %s | reinicio de %s\n",
+           cfg->checkpoint_cada, cfg->checkpoint,
+           cfg->reiniciar[0] != '\0' ? cfg->reiniciar : "-");
+  }
+  if (cfg->snapshot[0] != '\0') {
+    printf("              snapshot em %s a cada %d | reducao %d\n",
+           cfg->snapshot, cfg->snapshot_cada, cfg->snapshot_reducao);
+  }
+}
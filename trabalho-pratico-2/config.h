@@ -0,0 +1,57 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "grid.h"
+#include "logger.h"
+#include "migracao.h"
+#include "numa.h"
+#include "populacao.h"
+#include "visualizacao.h"
+
+// Parâmetros de execução da simulação. Os valores padrão reproduzem o
+// cenário original (grid 20x20, 100 agentes, 100 ciclos, estação de 10).
+typedef struct {
+  int largura;         // W_global
+  int altura;          // H_global
+  int n_agentes;       // Agentes no início da simulação (total global)
+  int ciclos;          // Ciclos totais (T)
+  int ciclos_estacao;  // Ciclos por estação (S)
+  unsigned int semente;
+  double taxa_seca;    // Regeneração por ciclo na estação SECA
+  double taxa_cheia;   // Regeneração por ciclo na estação CHEIA
+  double consumo;      // Recurso que cada agente tenta consumir por ciclo
+  double energia_reproducao; // Energia a partir da qual o agente se divide
+  int fator_carga;     // Iterações de carga sintética por unidade de recurso
+  Escalonamento escalonamento; // Repartição da carga entre as threads
+  Terreno terreno;     // Distribuição dos tipos de célula
+  Regeneracao regeneracao; // Varredura do grid inteiro ou só das visitadas
+  Afinidade afinidade; // Fixação das threads (aplicada antes do MPI_Init)
+  int procs_x;         // Processos no eixo X (0 = automático)
+  int procs_y;         // Processos no eixo Y (0 = automático)
+  ModoMigracao migracao;
+  int memoria_compartilhada; // Halo e agentes pela memória dentro do nó
+  int rebalancear_cada; // Ciclos entre rebalanceamentos (0 = desligado)
+  int reordenar_cada;  // Ciclos entre reordenações de Morton (0 = nunca)
+  int metricas_cada;   // Ciclos entre amostras das métricas globais
+  FormatoLog log_formato;
+  int log_descarga;    // Registros do log acumulados antes de cada escrita
+  int visualizar_cada; // 0 = modo benchmark (headless)
+  ModoVisualizacao visualizacao;
+  int visualizar_diferencas; // Reescreve só as células que mudaram
+  char relatorio[256]; // Relatório de tempos por fase ("" = nenhum)
+  int checkpoint_cada; // Ciclos entre checkpoints (0 = nunca)
+  char checkpoint[256]; // Arquivo de checkpoint
+  char reiniciar[256];  // Checkpoint de onde retomar ("" = início)
+  char snapshot[256];   // Arquivo de snapshots binários ("" = nenhum)
+  int snapshot_cada;    // Ciclos entre quadros
+  int snapshot_reducao; // Amostragem: células e ids múltiplos de N
+} Config;
+
+// Assinaturas
+void config_padrao(Config *cfg);
+int config_ler_arquivo(Config *cfg, const char *nome_arquivo);
+int config_ler_argumentos(Config *cfg, int argc, char **argv);
+void config_imprimir_uso(const char *programa);
+void config_imprimir(const Config *cfg);
+
+#endif
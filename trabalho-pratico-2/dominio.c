@@ -0,0 +1,199 @@
+#include "dominio.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+const int DIR_DX[N_DIRECOES] = {0, 0, -1, 1, -1, 1, 1, -1};
+const int DIR_DY[N_DIRECOES] = {-1, 1, 0, 0, -1, 1, -1, 1};
+
+Direcao direcao_de(int dx, int dy) {
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    if (DIR_DX[dir] == dx && DIR_DY[dir] == dy)
+      return (Direcao)dir;
+  }
+  return N_DIRECOES;
+}
+
+// Divide n itens entre p partes, com o resto nas primeiras partes.
+static void dividir(int n, int p, int *limites) {
+  for (int i = 0; i <= p; i++) {
+    limites[i] = i * (n / p) + (i < n % p ? i : n % p);
+  }
+}
+
+// Índice (no grid com halo) do canto superior esquerdo de uma região de
+// borda. Para dx/dy == 0 a região cobre toda a extensão do eixo; caso
+// contrário é a coluna/linha encostada no lado indicado. "fora" escolhe entre
+// a última fileira do interior (envio) e a fileira de halo (recepção).
+static int idx_regiao(const Dominio *d, int dx, int dy, int fora) {
+  int x = (dx < 0) ? 0 : (dx > 0) ? d->W_local - 1 : 0;
+  int y = (dy < 0) ? 0 : (dy > 0) ? d->H_local - 1 : 0;
+  if (fora) {
+    x += dx;
+    y += dy;
+  }
+  return dominio_idx(d, x, y);
+}
+
+// Recalcula a extensão do bloco local a partir dos limites e cria os tipos
+// das regiões de halo, que dependem dela: linhas (N/S) são contíguas, colunas
+// (O/L) têm passo W_local + 2 e os cantos são uma única célula.
+static void montar_bloco(Dominio *d) {
+  d->offsetY = d->limites_y[d->coords[0]];
+  d->offsetX = d->limites_x[d->coords[1]];
+  d->H_local = d->limites_y[d->coords[0] + 1] - d->offsetY;
+  d->W_local = d->limites_x[d->coords[1] + 1] - d->offsetX;
+
+  MPI_Datatype linha, coluna;
+  MPI_Type_contiguous(d->W_local, d->tipo_celula, &linha);
+  MPI_Type_vector(d->H_local, 1, d->W_local + 2, d->tipo_celula, &coluna);
+
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    int dx = DIR_DX[dir], dy = DIR_DY[dir];
+    MPI_Datatype base = (dx == 0) ? linha : (dy == 0) ? coluna : d->tipo_celula;
+    MPI_Type_dup(base, &d->tipo_regiao[dir]);
+    MPI_Type_commit(&d->tipo_regiao[dir]);
+    d->idx_envio[dir] = idx_regiao(d, dx, dy, 0);
+    d->idx_recepcao[dir] = idx_regiao(d, dx, dy, 1);
+  }
+  MPI_Type_free(&linha);
+  MPI_Type_free(&coluna);
+}
+
+int dominio_criar(Dominio *d, MPI_Comm comm, int W_global, int H_global,
+                  int procs_x, int procs_y) {
+  MPI_Comm_size(comm, &d->size);
+  if (procs_x < 0 || procs_y < 0 ||
+      (procs_x > 0 && d->size % procs_x != 0) ||
+      (procs_y > 0 && d->size % procs_y != 0) ||
+      (procs_x > 0 && procs_y > 0 && procs_x * procs_y != d->size)) {
+    return -1;
+  }
+
+  // dims[0] = processos no eixo Y, dims[1] = no eixo X. Sem imposição do
+  // usuário, o MPI escolhe a fatoração mais quadrada possível e o eixo mais
+  // longo do grid recebe o maior número de processos.
+  d->dims[0] = procs_y;
+  d->dims[1] = procs_x;
+  MPI_Dims_create(d->size, 2, d->dims);
+  if (procs_x == 0 && procs_y == 0 && W_global > H_global) {
+    int tmp = d->dims[0];
+    d->dims[0] = d->dims[1];
+    d->dims[1] = tmp;
+  }
+  if (d->dims[0] > H_global || d->dims[1] > W_global) {
+    return -1;
+  }
+
+  int periodos[2] = {0, 0};
+  MPI_Cart_create(comm, 2, d->dims, periodos, 1, &d->comm);
+  MPI_Comm_rank(d->comm, &d->rank);
+  MPI_Cart_coords(d->comm, d->rank, 2, d->coords);
+
+  d->W_global = W_global;
+  d->H_global = H_global;
+  d->limites_y = malloc((d->dims[0] + 1) * sizeof(int));
+  d->limites_x = malloc((d->dims[1] + 1) * sizeof(int));
+  dividir(H_global, d->dims[0], d->limites_y);
+  dividir(W_global, d->dims[1], d->limites_x);
+
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    int c[2] = {d->coords[0] + DIR_DY[dir], d->coords[1] + DIR_DX[dir]};
+    if (c[0] < 0 || c[0] >= d->dims[0] || c[1] < 0 || c[1] >= d->dims[1]) {
+      d->vizinhos[dir] = MPI_PROC_NULL;
+    } else {
+      MPI_Cart_rank(d->comm, c, &d->vizinhos[dir]);
+    }
+  }
+
+  MPI_Type_dup(MPI_DOUBLE, &d->tipo_celula);
+  MPI_Type_commit(&d->tipo_celula);
+  montar_bloco(d);
+  return 0;
+}
+
+static void liberar_tipos_regiao(Dominio *d) {
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    MPI_Type_free(&d->tipo_regiao[dir]);
+  }
+}
+
+// Adota novos limites de linhas e colunas (mesmo número de blocos por eixo,
+// cada um com ao menos uma fileira). A topologia e os vizinhos não mudam;
+// só a extensão do bloco local e os tipos de halo são refeitos. Os dados dos
+// planos locais ficam a cargo de quem chama.
+void dominio_repartir(Dominio *d, const int *limites_x, const int *limites_y) {
+  liberar_tipos_regiao(d);
+  for (int i = 0; i <= d->dims[1]; i++) {
+    d->limites_x[i] = limites_x[i];
+  }
+  for (int i = 0; i <= d->dims[0]; i++) {
+    d->limites_y[i] = limites_y[i];
+  }
+  montar_bloco(d);
+}
+
+void dominio_liberar(Dominio *d) {
+  liberar_tipos_regiao(d);
+  MPI_Type_free(&d->tipo_celula);
+  free(d->limites_x);
+  free(d->limites_y);
+  MPI_Comm_free(&d->comm);
+}
+
+// Busca binária do bloco (entre n, com limites[0..n]) que contém a posição p.
+int dominio_bloco(const int *limites, int n, int p) {
+  int ini = 0, fim = n - 1;
+  while (ini < fim) {
+    int meio = (ini + fim + 1) / 2;
+    if (limites[meio] <= p)
+      ini = meio;
+    else
+      fim = meio - 1;
+  }
+  return ini;
+}
+
+// Rank (no comunicador cartesiano) dono da célula global (gx, gy).
+int dominio_dono(const Dominio *d, int gx, int gy) {
+  int c[2] = {dominio_bloco(d->limites_y, d->dims[0], gy),
+              dominio_bloco(d->limites_x, d->dims[1], gx)};
+  int dono;
+  MPI_Cart_rank(d->comm, c, &dono);
+  return dono;
+}
+
+// Troca de halo não bloqueante com as oito vizinhanças (bordas e cantos): a
+// borda do lado "dir" vai para o vizinho desse lado, enquanto o halo do lado
+// oposto é preenchido pelo vizinho oposto. Até dominio_concluir_halo(), o
+// interior de plano pode ser lido mas não escrito, e o halo não pode ser lido.
+void dominio_iniciar_halo(const Dominio *d, double *plano,
+                          MPI_Request req[2 * N_DIRECOES]) {
+  dominio_iniciar_halo_com(d, d->vizinhos, plano, req);
+}
+
+// Mesma troca, só com os vizinhos dados (MPI_PROC_NULL nas direções em que o
+// halo é preenchido de outro jeito, sem mensagem).
+void dominio_iniciar_halo_com(const Dominio *d,
+                              const int vizinhos[N_DIRECOES], double *plano,
+                              MPI_Request req[2 * N_DIRECOES]) {
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    Direcao op = direcao_oposta(dir);
+    MPI_Irecv(&plano[d->idx_recepcao[op]], 1, d->tipo_regiao[op],
+              vizinhos[op], dir, d->comm, &req[dir]);
+  }
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    MPI_Isend(&plano[d->idx_envio[dir]], 1, d->tipo_regiao[dir],
+              vizinhos[dir], dir, d->comm, &req[N_DIRECOES + dir]);
+  }
+}
+
+void dominio_concluir_halo(MPI_Request req[2 * N_DIRECOES]) {
+  MPI_Waitall(2 * N_DIRECOES, req, MPI_STATUSES_IGNORE);
+}
+
+// Versão bloqueante, para quando não há trabalho a sobrepor.
+void dominio_trocar_halo(const Dominio *d, double *plano) {
+  MPI_Request req[2 * N_DIRECOES];
+  dominio_iniciar_halo(d, plano, req);
+  dominio_concluir_halo(req);
+}
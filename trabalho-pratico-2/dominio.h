@@ -0,0 +1,81 @@
+#ifndef DOMINIO_H
+#define DOMINIO_H
+
+#include <mpi.h>
+
+// Direções das oito vizinhanças do bloco local. N/S seguem o eixo Y (N = linha
+// de cima, y - 1) e O/L seguem o eixo X (O = coluna da esquerda, x - 1).
+typedef enum {
+  DIR_N,
+  DIR_S,
+  DIR_O,
+  DIR_L,
+  DIR_NO,
+  DIR_SE,
+  DIR_NE,
+  DIR_SO,
+  N_DIRECOES
+} Direcao;
+
+extern const int DIR_DX[N_DIRECOES];
+extern const int DIR_DY[N_DIRECOES];
+
+// Decomposição 2D do grid global sobre uma topologia cartesiana de processos.
+// dims[0]/coords[0] referem-se ao eixo Y (linhas) e dims[1]/coords[1] ao eixo
+// X (colunas). Os limites de cada bloco ficam em limites_y/limites_x
+// (dims + 1 entradas). De início o resto da divisão é espalhado pelos
+// primeiros blocos, de modo que nenhuma linha ou coluna seja descartada; o
+// balanceamento de carga pode depois mover os limites (dominio_repartir).
+typedef struct {
+  MPI_Comm comm; // Comunicador cartesiano (não periódico)
+  int rank, size;
+  int dims[2];
+  int coords[2];
+  int W_global, H_global;
+  int W_local, H_local;
+  int offsetX, offsetY;
+  int *limites_x;
+  int *limites_y;
+  int vizinhos[N_DIRECOES]; // MPI_PROC_NULL nas bordas globais
+
+  // Tipos MPI das regiões de borda (envio) e de halo (recepção) por direção,
+  // sobre um plano de doubles (o recurso do grid)
+  MPI_Datatype tipo_celula;
+  MPI_Datatype tipo_regiao[N_DIRECOES];
+  int idx_envio[N_DIRECOES];
+  int idx_recepcao[N_DIRECOES];
+} Dominio;
+
+// O grid local é guardado com um anel de halo de largura 1: (W+2) x (H+2)
+// células, com o interior em x = 0..W-1, y = 0..H-1.
+static inline int dominio_idx(const Dominio *d, int x, int y) {
+  return (y + 1) * (d->W_local + 2) + (x + 1);
+}
+
+static inline int dominio_celulas_com_halo(const Dominio *d) {
+  return (d->W_local + 2) * (d->H_local + 2);
+}
+
+static inline Direcao direcao_oposta(Direcao dir) {
+  return (Direcao)(dir ^ 1); // Pares opostos (N/S, O/L, NO/SE, NE/SO) são vizinhos no enum
+}
+
+// Converte um deslocamento (dx, dy) != (0, 0) na direção correspondente.
+Direcao direcao_de(int dx, int dy);
+
+// Assinaturas
+int dominio_criar(Dominio *d, MPI_Comm comm, int W_global, int H_global,
+                  int procs_x, int procs_y);
+void dominio_liberar(Dominio *d);
+void dominio_repartir(Dominio *d, const int *limites_x, const int *limites_y);
+int dominio_bloco(const int *limites, int n, int p);
+int dominio_dono(const Dominio *d, int gx, int gy);
+void dominio_trocar_halo(const Dominio *d, double *plano);
+void dominio_iniciar_halo(const Dominio *d, double *plano,
+                          MPI_Request req[2 * N_DIRECOES]);
+void dominio_iniciar_halo_com(const Dominio *d,
+                              const int vizinhos[N_DIRECOES], double *plano,
+                              MPI_Request req[2 * N_DIRECOES]);
+void dominio_concluir_halo(MPI_Request req[2 * N_DIRECOES]);
+
+#endif
@@ -0,0 +1,172 @@
+// Leitor dos snapshots gravados com --snapshot (serial, sem MPI).
+//
+//   ler_snapshot ARQUIVO                          lista os quadros
+//   ler_snapshot ARQUIVO QUADRO GRID [AGENTES]    exporta um quadro
+//
+// GRID termina em .ppm (imagem: recurso em verde, agentes em vermelho) ou em
+// .csv (gx,gy,recurso); AGENTES é sempre CSV (id,gx,gy,energia). QUADRO
+// conta a partir de 0; -1 é o último.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../snapshot_formato.h"
+
+#define RECURSO_MAXIMO 100.0 // Maior teto entre os tipos de célula
+
+static int termina_em(const char *nome, const char *sufixo) {
+  size_t n = strlen(nome), m = strlen(sufixo);
+  return n >= m && strcmp(nome + n - m, sufixo) == 0;
+}
+
+static void gravar_ppm(const char *nome, const CabecalhoSnapshot *cab,
+                       const float *plano, const AgenteSnapshot *agentes,
+                       long long n_agentes) {
+  int w = cab->largura_amostra, h = cab->altura_amostra;
+  unsigned char *rgb = (unsigned char *)malloc((size_t)w * h * 3);
+  for (long long k = 0; k < (long long)w * h; k++) {
+    double v = plano[k] / RECURSO_MAXIMO;
+    v = (v < 0.0) ? 0.0 : (v > 1.0) ? 1.0 : v;
+    rgb[3 * k] = 0;
+    rgb[3 * k + 1] = (unsigned char)(40 + 215 * v);
+    rgb[3 * k + 2] = 0;
+  }
+  for (long long a = 0; a < n_agentes; a++) {
+    long long k = (long long)(agentes[a].gy / cab->reducao) * w +
+                  agentes[a].gx / cab->reducao;
+    rgb[3 * k] = 255;
+    rgb[3 * k + 1] = 0;
+  }
+
+  FILE *f = fopen(nome, "wb");
+  if (f == NULL) {
+    fprintf(stderr, "Erro ao criar %s\n", nome);
+    exit(1);
+  }
+  fprintf(f, "P6\n%d %d\n255\n", w, h);
+  fwrite(rgb, 3, (size_t)w * h, f);
+  fclose(f);
+  free(rgb);
+}
+
+static void gravar_csv_grid(const char *nome, const CabecalhoSnapshot *cab,
+                            const float *plano) {
+  FILE *f = fopen(nome, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Erro ao criar %s\n", nome);
+    exit(1);
+  }
+  fprintf(f, "gx,gy,recurso\n");
+  for (int j = 0; j < cab->altura_amostra; j++) {
+    for (int i = 0; i < cab->largura_amostra; i++) {
+      fprintf(f, "%d,%d,%.2f\n", i * cab->reducao, j * cab->reducao,
+              plano[(long long)j * cab->largura_amostra + i]);
+    }
+  }
+  fclose(f);
+}
+
+static void gravar_csv_agentes(const char *nome, const AgenteSnapshot *agentes,
+                               long long n_agentes) {
+  FILE *f = fopen(nome, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Erro ao criar %s\n", nome);
+    exit(1);
+  }
+  fprintf(f, "id,gx,gy,energia\n");
+  for (long long a = 0; a < n_agentes; a++) {
+    fprintf(f, "%llu,%d,%d,%.2f\n", (unsigned long long)agentes[a].id,
+            agentes[a].gx, agentes[a].gy, agentes[a].energia);
+  }
+  fclose(f);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2 && argc != 4 && argc != 5) {
+    fprintf(stderr,
+            "Uso: %s ARQUIVO                        (lista os quadros)\n"
+            "     %s ARQUIVO QUADRO GRID [AGENTES]  (GRID .ppm ou .csv, "
+            "AGENTES .csv)\n",
+            argv[0], argv[0]);
+    return 1;
+  }
+
+  FILE *f = fopen(argv[1], "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Erro ao abrir %s\n", argv[1]);
+    return 1;
+  }
+  CabecalhoSnapshot cab;
+  if (fread(&cab, sizeof(cab), 1, f) != 1 ||
+      memcmp(cab.assinatura, SNAPSHOT_ASSINATURA, 8) != 0 ||
+      cab.tamanho_registro != sizeof(AgenteSnapshot)) {
+    fprintf(stderr, "%s nao e um arquivo de snapshots valido\n", argv[1]);
+    return 1;
+  }
+
+  // Percorre os quadros pelos cabeçalhos, pulando os dados
+  int alvo = (argc > 2) ? atoi(argv[2]) : -2;
+  long quadros_alocados = 64, n_quadros = 0;
+  long *posicao = (long *)malloc(quadros_alocados * sizeof(long));
+  QuadroSnapshot q;
+  long pos = sizeof(cab);
+  while (fseek(f, pos, SEEK_SET) == 0 && fread(&q, sizeof(q), 1, f) == 1) {
+    if (argc == 2) {
+      printf("quadro %ld: ciclo %d, estacao %s, %lld agentes amostrados\n",
+             n_quadros, q.ciclo, q.estacao == 0 ? "SECA" : "CHEIA",
+             (long long)q.n_agentes);
+    }
+    if (n_quadros == quadros_alocados) {
+      quadros_alocados *= 2;
+      posicao = (long *)realloc(posicao, quadros_alocados * sizeof(long));
+    }
+    posicao[n_quadros++] = pos;
+    pos += q.tamanho;
+  }
+  if (argc == 2) {
+    printf("%ld quadros, grid %dx%d amostrado a cada %d (%dx%d)\n", n_quadros,
+           cab.largura, cab.altura, cab.reducao, cab.largura_amostra,
+           cab.altura_amostra);
+    return 0;
+  }
+
+  if (alvo < 0) {
+    alvo += n_quadros;
+  }
+  if (alvo < 0 || alvo >= n_quadros) {
+    fprintf(stderr, "Quadro inexistente (o arquivo tem %ld)\n", n_quadros);
+    return 1;
+  }
+
+  long long n_celulas = (long long)cab.largura_amostra * cab.altura_amostra;
+  fseek(f, posicao[alvo], SEEK_SET);
+  if (fread(&q, sizeof(q), 1, f) != 1) {
+    fprintf(stderr, "Quadro %d truncado\n", alvo);
+    return 1;
+  }
+  float *plano = (float *)malloc(n_celulas * sizeof(float));
+  AgenteSnapshot *agentes = (AgenteSnapshot *)malloc(
+      (q.n_agentes > 0 ? q.n_agentes : 1) * sizeof(AgenteSnapshot));
+  if (fread(plano, sizeof(float), n_celulas, f) != (size_t)n_celulas ||
+      fread(agentes, sizeof(AgenteSnapshot), q.n_agentes, f) !=
+          (size_t)q.n_agentes) {
+    fprintf(stderr, "Quadro %d truncado\n", alvo);
+    return 1;
+  }
+  fclose(f);
+
+  if (termina_em(argv[3], ".ppm")) {
+    gravar_ppm(argv[3], &cab, plano, agentes, q.n_agentes);
+  } else {
+    gravar_csv_grid(argv[3], &cab, plano);
+  }
+  if (argc == 5) {
+    gravar_csv_agentes(argv[4], agentes, q.n_agentes);
+  }
+  printf("Quadro %d (ciclo %d) exportado\n", alvo, q.ciclo);
+
+  free(plano);
+  free(agentes);
+  free(posicao);
+  return 0;
+}
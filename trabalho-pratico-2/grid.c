@@ -1,9 +1,55 @@
 #include "grid.h"
 #include <stdlib.h>
+#include <string.h>
 
-TipoCelula f_tipo(int gx, int gy) {
-  int val = (gx * 31 + gy * 7) % 5;
-  return (TipoCelula)abs(val);
+// Escala dos agregados da regeneração adiada: 2^-20 unidades de recurso
+#define ESCALA_AGREGADO 1048576.0
+
+static const char *nomes_terreno[] = {"misto", "concentrado"};
+static const char *nomes_regeneracao[] = {"completa", "adiada"};
+
+int grid_terreno_de(const char *nome, Terreno *terreno) {
+  for (int k = 0; k < 2; k++) {
+    if (strcmp(nome, nomes_terreno[k]) == 0) {
+      *terreno = (Terreno)k;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *grid_terreno_nome(Terreno terreno) {
+  return nomes_terreno[terreno];
+}
+
+int grid_regeneracao_de(const char *nome, Regeneracao *modo) {
+  for (int k = 0; k < 2; k++) {
+    if (strcmp(nome, nomes_regeneracao[k]) == 0) {
+      *modo = (Regeneracao)k;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *grid_regeneracao_nome(Regeneracao modo) {
+  return nomes_regeneracao[modo];
+}
+
+// No terreno concentrado o custo da carga (proporcional ao recurso) fica
+// desigual: o quarto oeste só tem aldeias e roçados (100 e 80), e no resto
+// eles viram coleta (30).
+TipoCelula f_tipo(Terreno terreno, int gx, int gy, int W_global) {
+  int val = abs((gx * 31 + gy * 7) % 5);
+  if (terreno == TERRENO_CONCENTRADO) {
+    if (gx < W_global / 4) {
+      return (val % 2 == 0) ? ALDEIA : ROCADO;
+    }
+    if (val == ALDEIA || val == ROCADO) {
+      return COLETA;
+    }
+  }
+  return (TipoCelula)val;
 }
 
 double f_recurso(TipoCelula tipo) {
@@ -22,3 +68,395 @@ double f_recurso(TipoCelula tipo) {
     return 10.0;
   }
 }
+
+// Aloca os planos (todas as células começam INTERDITA, sem recurso e
+// inacessíveis) e pré-calcula as tabelas por tipo, tirando o switch de
+// f_recurso() do laço de regeneração. Os planos são escritos pela primeira
+// vez em paralelo, com a mesma divisão estática das linhas que a
+// regeneração usa, para que as páginas fiquem no nó NUMA de quem as percorre.
+// Na regeneração adiada, todas as células valem no ciclo dos agregados.
+static void alocar_planos(Grid *g, int n_celulas) {
+  g->n_celulas = n_celulas;
+  g->tipo = (uint8_t *)malloc(n_celulas * sizeof(uint8_t));
+  if (g->comm_no != MPI_COMM_NULL) {
+    // Coletiva no nó. Cada processo com o seu trecho separado (e nas suas
+    // páginas), acessível por load/store numa época passiva permanente
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    MPI_Win_allocate_shared((MPI_Aint)n_celulas * sizeof(double),
+                            sizeof(double), info, g->comm_no, &g->recurso,
+                            &g->janela);
+    MPI_Info_free(&info);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, g->janela);
+  } else {
+    g->recurso = (double *)malloc(n_celulas * sizeof(double));
+    g->janela = MPI_WIN_NULL;
+  }
+  g->acessivel = (uint64_t *)calloc((n_celulas + 63) / 64, sizeof(uint64_t));
+  g->demanda = (int *)malloc(n_celulas * sizeof(int));
+  RegeneracaoAdiada *a = &g->adiada;
+  if (a->ativa) {
+    a->ciclo = (int *)malloc(n_celulas * sizeof(int));
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int k = 0; k < n_celulas; k++) {
+    g->tipo[k] = INTERDITA;
+    g->recurso[k] = 0.0;
+    g->demanda[k] = 0;
+    if (a->ativa) {
+      a->ciclo[k] = a->agora;
+    }
+  }
+}
+
+static void liberar_planos(Grid *g) {
+  free(g->tipo);
+  if (g->janela != MPI_WIN_NULL) {
+    MPI_Win_unlock_all(g->janela);
+    MPI_Win_free(&g->janela);
+  } else {
+    free(g->recurso);
+  }
+  free(g->acessivel);
+  free(g->demanda);
+  if (g->adiada.ativa) {
+    free(g->adiada.ciclo);
+  }
+}
+
+void grid_iniciar(Grid *g, int n_celulas, double taxa_seca, double taxa_cheia,
+                  double consumo, Terreno terreno, MPI_Comm comm_no) {
+  g->comm_no = comm_no;
+  g->adiada.ativa = 0;
+  alocar_planos(g, n_celulas);
+  g->consumo = consumo;
+  g->terreno = terreno;
+
+  for (int tipo = 0; tipo < N_TIPOS; tipo++) {
+    g->teto[tipo] = f_recurso((TipoCelula)tipo);
+    bool regenera = (tipo != ALDEIA && tipo != INTERDITA);
+    g->taxa[SECA][tipo] = regenera ? taxa_seca : 0.0;
+    g->taxa[CHEIA][tipo] = regenera ? taxa_cheia : 0.0;
+    g->cresce[tipo] = regenera ? 1.0 : 0.0;
+  }
+}
+
+void grid_liberar(Grid *g) {
+  liberar_planos(g);
+  if (g->adiada.ativa) {
+    free(g->adiada.acumulado);
+    free(g->adiada.satura_n);
+    free(g->adiada.satura_base);
+    free(g->adiada.satura_teto);
+  }
+}
+
+// Realoca os planos para um bloco de outro tamanho (após um rebalanceamento),
+// com todas as células de volta a INTERDITA. As tabelas por tipo (e a das
+// estações, na regeneração adiada) são mantidas. Com a janela compartilhada,
+// é coletiva entre os processos do nó.
+void grid_redimensionar(Grid *g, int n_celulas) {
+  liberar_planos(g);
+  alocar_planos(g, n_celulas);
+}
+
+// Preenche o bloco de d (halo incluído) com o tipo de cada posição global e o
+// recurso cheio. O tipo depende só da posição, então o halo também recebe o
+// seu; fora do grid global as células continuam INTERDITA/inacessíveis. O
+// recurso do halo é sobrescrito a cada troca com os vizinhos.
+void grid_preencher(Grid *g, const Dominio *d) {
+#pragma omp parallel for schedule(static)
+  for (int j = -1; j <= d->H_local; j++) {
+    for (int i = -1; i <= d->W_local; i++) {
+      int gx = d->offsetX + i;
+      int gy = d->offsetY + j;
+      if (gx < 0 || gx >= d->W_global || gy < 0 || gy >= d->H_global) {
+        continue;
+      }
+
+      int idx = dominio_idx(d, i, j);
+      g->tipo[idx] = (uint8_t)f_tipo(g->terreno, gx, gy, d->W_global);
+      g->recurso[idx] = g->teto[g->tipo[idx]];
+    }
+  }
+
+  // Os bits de linhas vizinhas dividem palavras do bitset, então a marcação
+  // fica fora do laço paralelo
+  for (int j = -1; j <= d->H_local; j++) {
+    int gy = d->offsetY + j;
+    if (gy < 0 || gy >= d->H_global) {
+      continue;
+    }
+    for (int i = -1; i <= d->W_local; i++) {
+      int gx = d->offsetX + i;
+      if (gx >= 0 && gx < d->W_global) {
+        grid_marcar_acessivel(g, dominio_idx(d, i, j), true);
+      }
+    }
+  }
+}
+
+// Consumo e regeneração das células [ini, fim) de uma linha. Primeiro debita
+// o que os demanda[k] agentes comeram (as partes de grid_parte(): o pedido
+// inteiro, ou tudo o que havia) e zera a demanda; depois cresce pela taxa da
+// estação e limita ao teto do tipo. Para ALDEIA/INTERDITA a taxa é zero e o
+// recurso nunca passa do teto, então o resultado é o mesmo do desvio
+// condicional, mas sem desvio: o laço vetoriza. Retorna o recurso total do
+// trecho já regenerado, para as métricas do ciclo.
+double grid_regenerar(Grid *g, Estacao estacao, int ini, int fim) {
+  const uint8_t *restrict tipo = g->tipo;
+  double *restrict recurso = g->recurso;
+  int *restrict demanda = g->demanda;
+  const double *taxa = g->taxa[estacao];
+  const double *teto = g->teto;
+  double consumo = g->consumo;
+  double soma = 0.0;
+
+#pragma omp simd reduction(+ : soma)
+  for (int k = ini; k < fim; k++) {
+    double pedido = demanda[k] * consumo;
+    double disponivel = (recurso[k] > 0.0) ? recurso[k] : 0.0;
+    double r = recurso[k] - ((pedido < disponivel) ? pedido : disponivel);
+    demanda[k] = 0;
+
+    r += taxa[tipo[k]];
+    double limite = teto[tipo[k]];
+    recurso[k] = (r > limite) ? limite : r;
+    soma += recurso[k];
+  }
+  return soma;
+}
+
+// ----------------------------------------------------------------------------
+// Regeneração adiada
+// ----------------------------------------------------------------------------
+
+// Contribuição de uma ou mais células aos agregados
+typedef struct {
+  long long fixo, base, crescendo;
+} Parcela;
+
+static long long em_unidades(double x) {
+  double u = x * ESCALA_AGREGADO;
+  return (long long)(u + (u >= 0.0 ? 0.5 : -0.5));
+}
+
+// Primeiro ciclo em (c, ultimo] em que r, crescendo desde c, chega ao teto
+// (a mesma comparação de grid_valor_adiado()), ou ultimo + 1 se não chega.
+// acumulado não decresce, então a busca é binária.
+static int ciclo_saturacao(const RegeneracaoAdiada *a, double r, int c,
+                           double teto) {
+  int ini = c + 1, fim = a->ultimo + 1;
+  while (ini < fim) {
+    int meio = ini + (fim - ini) / 2;
+    if (r + (a->acumulado[meio] - a->acumulado[c]) >= teto)
+      fim = meio;
+    else
+      ini = meio + 1;
+  }
+  return ini;
+}
+
+// Soma (sinal = 1) ou tira (sinal = -1) a célula k dos agregados, no estado
+// (recurso, ciclo) em que ela está. Os termos escalares vão para p; os da
+// saturação, direto nas tabelas por ciclo, que podem ser tocadas por várias
+// tarefas ao mesmo tempo.
+static void contribuir(Grid *g, int k, int sinal, Parcela *p) {
+  RegeneracaoAdiada *a = &g->adiada;
+  int tipo = g->tipo[k];
+  double r = g->recurso[k], teto = g->teto[tipo];
+  if (g->cresce[tipo] == 0.0 || r >= teto) {
+    p->fixo += sinal * em_unidades(r);
+    return;
+  }
+
+  int c = a->ciclo[k];
+  int satura = ciclo_saturacao(a, r, c, teto);
+  if (satura <= a->agora) {
+    p->fixo += sinal * em_unidades(teto);
+    return;
+  }
+  long long base = em_unidades(r - a->acumulado[c]);
+  p->base += sinal * base;
+  p->crescendo += sinal;
+  if (satura <= a->ultimo) {
+    long long termo_teto = sinal * em_unidades(teto);
+#pragma omp atomic update
+    a->satura_n[satura] += sinal;
+#pragma omp atomic update
+    a->satura_base[satura] += sinal * base;
+#pragma omp atomic update
+    a->satura_teto[satura] += termo_teto;
+  }
+}
+
+static void somar_parcela(RegeneracaoAdiada *a, const Parcela *p) {
+#pragma omp atomic update
+  a->fixo += p->fixo;
+#pragma omp atomic update
+  a->base += p->base;
+#pragma omp atomic update
+  a->crescendo += p->crescendo;
+}
+
+// Traz a célula k para o ciclo (que deve ser o dos agregados), sem mudar o
+// seu valor nem o total.
+static void atualizar_celula(Grid *g, int k, int ciclo, Parcela *p) {
+  if (g->adiada.ciclo[k] == ciclo) {
+    return;
+  }
+  contribuir(g, k, -1, p);
+  g->recurso[k] = grid_valor_adiado(g, k, ciclo);
+  g->adiada.ciclo[k] = ciclo;
+  contribuir(g, k, 1, p);
+}
+
+void grid_adiar(Grid *g, const Dominio *d, int ciclo_inicial, int ultimo,
+                Estacao estacao, int ciclos_estacao) {
+  RegeneracaoAdiada *a = &g->adiada;
+  a->ativa = 1;
+  a->ultimo = ultimo;
+  a->agora = ciclo_inicial;
+  a->acumulado = (double *)calloc(ultimo + 1, sizeof(double));
+  a->satura_n = (long long *)calloc(ultimo + 1, sizeof(long long));
+  a->satura_base = (long long *)calloc(ultimo + 1, sizeof(long long));
+  a->satura_teto = (long long *)calloc(ultimo + 1, sizeof(long long));
+
+  // Mesma troca de estação do laço principal; a taxa é a mesma em todos os
+  // tipos que regeneram
+  for (int t = ciclo_inicial; t < ultimo; t++) {
+    if (t > 0 && t % ciclos_estacao == 0) {
+      estacao = (estacao == SECA) ? CHEIA : SECA;
+    }
+    a->acumulado[t + 1] = a->acumulado[t] + g->taxa[estacao][PESCA];
+  }
+
+  a->ciclo = (int *)malloc(g->n_celulas * sizeof(int));
+#pragma omp parallel for schedule(static)
+  for (int k = 0; k < g->n_celulas; k++) {
+    a->ciclo[k] = ciclo_inicial;
+  }
+#pragma omp parallel
+  grid_adiada_recontar(g, d);
+}
+
+// Refaz os agregados percorrendo o interior do bloco (depois de um
+// rebalanceamento, ou de reescrever o plano inteiro). Chamada por todas as
+// threads da região paralela, que dividem as linhas entre si (termina numa
+// barreira); fora de uma região, percorre tudo sozinha.
+void grid_adiada_recontar(Grid *g, const Dominio *d) {
+  RegeneracaoAdiada *a = &g->adiada;
+#pragma omp single
+  {
+    memset(a->satura_n, 0, (a->ultimo + 1) * sizeof(long long));
+    memset(a->satura_base, 0, (a->ultimo + 1) * sizeof(long long));
+    memset(a->satura_teto, 0, (a->ultimo + 1) * sizeof(long long));
+    a->fixo = 0;
+    a->base = 0;
+    a->crescendo = 0;
+  }
+  // Os agregados são inteiros: a soma não depende da ordem das threads
+  Parcela p = {0, 0, 0};
+#pragma omp for schedule(static) nowait
+  for (int j = 0; j < d->H_local; j++) {
+    for (int i = 0; i < d->W_local; i++) {
+      contribuir(g, dominio_idx(d, i, j), 1, &p);
+    }
+  }
+  somar_parcela(a, &p);
+#pragma omp barrier
+}
+
+// Anel de borda do interior trazido ao ciclo, antes de ir para o halo dos
+// vizinhos (que leem recurso[] direto).
+void grid_adiada_borda(Grid *g, const Dominio *d, int ciclo) {
+  Parcela p = {0, 0, 0};
+  int W = d->W_local, H = d->H_local;
+  for (int i = 0; i < W; i++) {
+    atualizar_celula(g, dominio_idx(d, i, 0), ciclo, &p);
+    atualizar_celula(g, dominio_idx(d, i, H - 1), ciclo, &p);
+  }
+  for (int j = 1; j < H - 1; j++) {
+    atualizar_celula(g, dominio_idx(d, 0, j), ciclo, &p);
+    atualizar_celula(g, dominio_idx(d, W - 1, j), ciclo, &p);
+  }
+  somar_parcela(&g->adiada, &p);
+}
+
+// O halo acabou de chegar com o valor do início do ciclo.
+void grid_adiada_halo(Grid *g, const Dominio *d, int ciclo) {
+  int *c = g->adiada.ciclo;
+  int W = d->W_local, H = d->H_local;
+  for (int i = -1; i <= W; i++) {
+    c[dominio_idx(d, i, -1)] = ciclo;
+    c[dominio_idx(d, i, H)] = ciclo;
+  }
+  for (int j = 0; j < H; j++) {
+    c[dominio_idx(d, -1, j)] = ciclo;
+    c[dominio_idx(d, W, j)] = ciclo;
+  }
+}
+
+// Consumo e regeneração, como em grid_regenerar(), só das n células dadas
+// (as que tiveram demanda no ciclo, cada uma uma vez): a célula é trazida ao
+// ciclo, debitada e regenerada, e passa a valer no início do próximo.
+void grid_regenerar_celulas(Grid *g, Estacao estacao, const int *celulas,
+                            int n, int ciclo) {
+  RegeneracaoAdiada *a = &g->adiada;
+  const double *taxa = g->taxa[estacao];
+  Parcela p = {0, 0, 0};
+
+  for (int m = 0; m < n; m++) {
+    int k = celulas[m];
+    contribuir(g, k, -1, &p);
+
+    double v = grid_valor_adiado(g, k, ciclo);
+    double pedido = g->demanda[k] * g->consumo;
+    double disponivel = (v > 0.0) ? v : 0.0;
+    double r = v - ((pedido < disponivel) ? pedido : disponivel);
+    g->demanda[k] = 0;
+
+    r += taxa[g->tipo[k]];
+    double limite = g->teto[g->tipo[k]];
+    g->recurso[k] = (r > limite) ? limite : r;
+    a->ciclo[k] = ciclo + 1;
+    contribuir(g, k, 1, &p);
+  }
+  somar_parcela(a, &p);
+}
+
+// Leva os agregados ao início do ciclo (as células que saturaram no caminho
+// passam para o fixo) e devolve o recurso total do interior do bloco.
+double grid_adiada_avancar(Grid *g, int ciclo) {
+  RegeneracaoAdiada *a = &g->adiada;
+  for (int t = a->agora + 1; t <= ciclo; t++) {
+    a->crescendo -= a->satura_n[t];
+    a->base -= a->satura_base[t];
+    a->fixo += a->satura_teto[t];
+  }
+  a->agora = ciclo;
+  // O crescimento comum entra fora da escala, para que o seu arredondamento
+  // não seja multiplicado pelo número de células
+  return (a->fixo + a->base) / ESCALA_AGREGADO +
+         a->crescendo * a->acumulado[ciclo];
+}
+
+// Escreve em recurso[] o valor de todo o interior no ciclo dos agregados,
+// para quem lê o plano inteiro (visualização, checkpoint, snapshot,
+// rebalanceamento). Custa uma varredura, como um ciclo da regeneração
+// completa, dividida por linhas entre as threads da região paralela, que
+// devem chamá-la todas.
+void grid_adiada_materializar(Grid *g, const Dominio *d) {
+  RegeneracaoAdiada *a = &g->adiada;
+#pragma omp for schedule(static)
+  for (int j = 0; j < d->H_local; j++) {
+    for (int i = 0; i < d->W_local; i++) {
+      int k = dominio_idx(d, i, j);
+      g->recurso[k] = grid_valor_adiado(g, k, a->agora);
+      a->ciclo[k] = a->agora;
+    }
+  }
+  grid_adiada_recontar(g, d);
+}
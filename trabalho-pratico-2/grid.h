@@ -2,19 +2,152 @@
 #define GRID_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
-typedef enum { ALDEIA, PESCA, COLETA, ROCADO, INTERDITA } TipoCelula;
+#include "dominio.h"
+
+typedef enum { ALDEIA, PESCA, COLETA, ROCADO, INTERDITA, N_TIPOS } TipoCelula;
 
 typedef enum { SECA, CHEIA } Estacao;
 
+// Distribuição dos tipos de célula no grid global
+typedef enum {
+  TERRENO_MISTO,       // Padrão original, os tipos intercalados por toda parte
+  TERRENO_CONCENTRADO, // Aldeias e roçados (os tipos mais ricos) só no
+                       // quarto oeste; o resto fica com os mais pobres
+} Terreno;
+
+// Como a regeneração percorre o grid a cada ciclo
+typedef enum {
+  REGENERACAO_COMPLETA, // Todas as células do bloco, em faixas de linhas
+  REGENERACAO_ADIADA,   // Só as visitadas; as outras crescem em forma fechada
+} Regeneracao;
+
+// Estado da regeneração adiada. recurso[k] vale no início do ciclo ciclo[k]
+// e, em outro ciclo t, a célula tem
+//   min(teto, recurso[k] + cresce[tipo] * (acumulado[t] - acumulado[ciclo[k]]))
+// (acumulado[t] é a soma das taxas das estações antes de t), o mesmo valor
+// que a regeneração completa chegaria somando taxa por taxa. Só as células
+// consumidas no ciclo (e o anel de borda, antes de ir para os vizinhos) são
+// atualizadas.
+//
+// O total do bloco sai de agregados em inteiros de 2^-20 unidades de recurso,
+// em que a soma não depende da ordem (e é exata se as taxas, o consumo e os
+// tetos são múltiplos dessa unidade, como os padrões): "fixo" soma as células que não crescem
+// mais (tipos que não regeneram ou já no teto); as que crescem valem
+// recurso - acumulado[ciclo] (somados em "base") mais acumulado[agora]. Cada
+// uma que ainda cresce entra também no ciclo em que atinge o teto, quando
+// passa de "base" para "fixo".
+typedef struct {
+  int ativa;
+  int *ciclo;        // Por célula, com o halo
+  double *acumulado; // [0, ultimo]
+  int ultimo;        // Último ciclo da tabela (o fim da simulação)
+  int agora;         // Ciclo a que os agregados se referem
+  long long fixo, base, crescendo;
+  // Por ciclo de saturação: quantas células e os seus termos em base e fixo
+  long long *satura_n, *satura_base, *satura_teto;
+} RegeneracaoAdiada;
+
+// Grid local em planos separados (SoA) com anel de halo, indexado por
+// dominio_idx(): tipo em 1 byte por célula, recurso em double e
+// acessibilidade em um bit por célula. O tipo é função fixa da posição
+// global, então só o plano de recurso precisa ser trocado no halo.
+//
+// demanda conta os agentes que consomem na célula no ciclo corrente; é zero
+// fora da etapa de consumo, pois a regeneração a zera ao debitar a célula.
+//
+// Com comm_no (--memoria-compartilhada), o plano de recurso fica numa janela
+// MPI_Win_allocate_shared dos processos do nó, aberta para leitura direta
+// pelos vizinhos (ver janela.h); sem ele, no heap.
 typedef struct {
-  TipoCelula tipo;
-  double recurso;
-  bool acessivel;
-} Celula;
+  int n_celulas; // Incluindo o halo
+  uint8_t *tipo;
+  double *recurso;
+  MPI_Comm comm_no; // MPI_COMM_NULL = recurso no heap
+  MPI_Win janela;   // Janela do recurso (MPI_WIN_NULL sem comm_no)
+  uint64_t *acessivel; // Bitset, 1 bit por célula
+  int *demanda;
+
+  double consumo; // Recurso que cada agente tenta consumir por ciclo
+  Terreno terreno;
+
+  // Tabelas por tipo: teto de recurso e taxa de regeneração por estação
+  // (zero para ALDEIA e INTERDITA, que não regeneram)
+  double teto[N_TIPOS];
+  double taxa[2][N_TIPOS];
+  double cresce[N_TIPOS]; // 1 para os tipos que regeneram, senão 0
+
+  RegeneracaoAdiada adiada; // Desligada (ativa = 0) na regeneração completa
+} Grid;
 
 // Assinaturas das funções
-TipoCelula f_tipo(int gx, int gy);
+TipoCelula f_tipo(Terreno terreno, int gx, int gy, int W_global);
 double f_recurso(TipoCelula tipo);
 
+void grid_iniciar(Grid *g, int n_celulas, double taxa_seca, double taxa_cheia,
+                  double consumo, Terreno terreno, MPI_Comm comm_no);
+int grid_terreno_de(const char *nome, Terreno *terreno);
+const char *grid_terreno_nome(Terreno terreno);
+int grid_regeneracao_de(const char *nome, Regeneracao *modo);
+const char *grid_regeneracao_nome(Regeneracao modo);
+void grid_liberar(Grid *g);
+void grid_redimensionar(Grid *g, int n_celulas);
+void grid_preencher(Grid *g, const Dominio *d);
+double grid_regenerar(Grid *g, Estacao estacao, int ini, int fim);
+
+// Regeneração adiada (ver RegeneracaoAdiada). grid_adiar() liga o modo com
+// todas as células valendo no ciclo_inicial; a tabela das estações repete a
+// troca do laço principal (a cada ciclos_estacao ciclos, a partir de estacao
+// no ciclo_inicial) até o ciclo ultimo.
+void grid_adiar(Grid *g, const Dominio *d, int ciclo_inicial, int ultimo,
+                Estacao estacao, int ciclos_estacao);
+void grid_adiada_borda(Grid *g, const Dominio *d, int ciclo);
+void grid_adiada_halo(Grid *g, const Dominio *d, int ciclo);
+void grid_regenerar_celulas(Grid *g, Estacao estacao, const int *celulas,
+                            int n, int ciclo);
+double grid_adiada_avancar(Grid *g, int ciclo);
+void grid_adiada_materializar(Grid *g, const Dominio *d);
+void grid_adiada_recontar(Grid *g, const Dominio *d);
+
+// Recurso da célula idx no início do ciclo, na regeneração adiada.
+static inline double grid_valor_adiado(const Grid *g, int idx, int ciclo) {
+  int tipo = g->tipo[idx];
+  const double *acumulado = g->adiada.acumulado;
+  double r = g->recurso[idx] +
+             g->cresce[tipo] * (acumulado[ciclo] -
+                                acumulado[g->adiada.ciclo[idx]]);
+  return (r > g->teto[tipo]) ? g->teto[tipo] : r;
+}
+
+// Recurso da célula idx no início do ciclo, em qualquer modo.
+static inline double grid_valor(const Grid *g, int idx, int ciclo) {
+  return g->adiada.ativa ? grid_valor_adiado(g, idx, ciclo) : g->recurso[idx];
+}
+
+// Parte do recurso da célula idx que cabe a cada um dos seus demanda[idx]
+// agentes: o consumo inteiro se há para todos, senão o que resta dividido em
+// partes iguais. Só lê o grid, então pode ser chamada por qualquer thread
+// durante a etapa de consumo; a célula é debitada em grid_regenerar().
+static inline double grid_parte(const Grid *g, int idx, int ciclo) {
+  double r = grid_valor(g, idx, ciclo);
+  int k = g->demanda[idx];
+  if (r >= k * g->consumo) {
+    return g->consumo;
+  }
+  return (r > 0.0) ? r / k : 0.0;
+}
+
+static inline bool grid_acessivel(const Grid *g, int idx) {
+  return (g->acessivel[idx >> 6] >> (idx & 63)) & 1;
+}
+
+static inline void grid_marcar_acessivel(Grid *g, int idx, bool valor) {
+  uint64_t bit = (uint64_t)1 << (idx & 63);
+  if (valor)
+    g->acessivel[idx >> 6] |= bit;
+  else
+    g->acessivel[idx >> 6] &= ~bit;
+}
+
 #endif
@@ -0,0 +1,176 @@
+#include "instrumentacao.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *nomes_fase[N_FASES] = {
+    "5.1 estacao",  "5.2 halo",     "5.3 agentes",       "5.4 migracao",
+    "5.5 grid",     "5.6 metricas", "5.7 balanceamento", "5.8 visualizacao",
+    "5.9 checkpoint", "5.10 snapshot", "5.11 reordenacao"};
+
+static const char *nomes_etapa[N_ETAPAS] = {
+    "carga", "movimento", "espera_halo", "consumo", "energia", "compactacao"};
+
+// Fases dominadas por comunicação MPI, somadas na fração de comunicação
+static const int fase_comunicacao[N_FASES] = {1, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0};
+
+// Mínimo, média e máximo de uma grandeza entre processos (ou threads)
+typedef struct {
+  double min, media, max;
+} Resumo;
+
+void instrumentacao_iniciar(Instrumentacao *in, int n_threads) {
+  memset(in->fase, 0, sizeof(in->fase));
+  in->marca = 0.0;
+  in->n_threads = n_threads;
+  in->etapa = (double *)calloc(n_threads * PASSO_ETAPAS, sizeof(double));
+}
+
+void instrumentacao_liberar(Instrumentacao *in) { free(in->etapa); }
+
+static double desbalanceamento(const Resumo *r) {
+  return (r->media > 0.0) ? r->max / r->media : 1.0;
+}
+
+static double fracao(const Resumo *r, double tempo_total) {
+  return (tempo_total > 0.0) ? r->media / tempo_total : 0.0;
+}
+
+static void gravar_csv(FILE *f, const Resumo *fases, const Resumo *etapas,
+                       double tempo_total) {
+  fprintf(f, "escopo,nome,min,media,max,desbalanceamento,fracao\n");
+  for (int k = 0; k < N_FASES; k++) {
+    fprintf(f, "processo,%s,%.6f,%.6f,%.6f,%.4f,%.4f\n", nomes_fase[k],
+            fases[k].min, fases[k].media, fases[k].max,
+            desbalanceamento(&fases[k]), fracao(&fases[k], tempo_total));
+  }
+  for (int e = 0; e < N_ETAPAS; e++) {
+    fprintf(f, "thread,%s,%.6f,%.6f,%.6f,%.4f,%.4f\n", nomes_etapa[e],
+            etapas[e].min, etapas[e].media, etapas[e].max,
+            desbalanceamento(&etapas[e]), fracao(&etapas[e], tempo_total));
+  }
+}
+
+static void gravar_json(FILE *f, const Resumo *fases, const Resumo *etapas,
+                        const double *por_processo, int size, int threads,
+                        double tempo_total, double comunicacao) {
+  fprintf(f, "{\n  \"processos\": %d,\n  \"threads\": %d,\n", size, threads);
+  fprintf(f, "  \"tempo_total\": %.6f,\n  \"fracao_comunicacao\": %.4f,\n",
+          tempo_total, comunicacao);
+  fprintf(f, "  \"fases\": [\n");
+  for (int k = 0; k < N_FASES; k++) {
+    fprintf(f,
+            "    {\"nome\": \"%s\", \"min\": %.6f, \"media\": %.6f, "
+            "\"max\": %.6f, \"desbalanceamento\": %.4f, \"por_processo\": [",
+            nomes_fase[k], fases[k].min, fases[k].media, fases[k].max,
+            desbalanceamento(&fases[k]));
+    for (int r = 0; r < size; r++) {
+      fprintf(f, "%s%.6f", r ? ", " : "", por_processo[r * N_FASES + k]);
+    }
+    fprintf(f, "]}%s\n", k + 1 < N_FASES ? "," : "");
+  }
+  fprintf(f, "  ],\n  \"etapas_thread\": [\n");
+  for (int e = 0; e < N_ETAPAS; e++) {
+    fprintf(f,
+            "    {\"nome\": \"%s\", \"min\": %.6f, \"media\": %.6f, "
+            "\"max\": %.6f, \"desbalanceamento\": %.4f}%s\n",
+            nomes_etapa[e], etapas[e].min, etapas[e].media, etapas[e].max,
+            desbalanceamento(&etapas[e]), e + 1 < N_ETAPAS ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+}
+
+void instrumentacao_relatorio(const Instrumentacao *in, MPI_Comm comm,
+                              double tempo_total, const char *arquivo) {
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  // Fases: o rank 0 recebe os tempos de todos (também vão ao JSON)
+  double *por_processo = NULL;
+  if (rank == 0) {
+    por_processo = (double *)malloc(size * N_FASES * sizeof(double));
+  }
+  MPI_Gather(in->fase, N_FASES, MPI_DOUBLE, por_processo, N_FASES, MPI_DOUBLE,
+             0, comm);
+
+  // Etapas: mínimo, máximo e soma entre as threads locais, depois entre
+  // processos
+  double e_min[N_ETAPAS], e_max[N_ETAPAS], e_soma[N_ETAPAS];
+  for (int e = 0; e < N_ETAPAS; e++) {
+    e_min[e] = e_max[e] = in->etapa[e];
+    e_soma[e] = 0.0;
+    for (int k = 0; k < in->n_threads; k++) {
+      double v = in->etapa[k * PASSO_ETAPAS + e];
+      e_min[e] = (v < e_min[e]) ? v : e_min[e];
+      e_max[e] = (v > e_max[e]) ? v : e_max[e];
+      e_soma[e] += v;
+    }
+  }
+  int threads = 0;
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : e_min, e_min, N_ETAPAS, MPI_DOUBLE,
+             MPI_MIN, 0, comm);
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : e_max, e_max, N_ETAPAS, MPI_DOUBLE,
+             MPI_MAX, 0, comm);
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : e_soma, e_soma, N_ETAPAS, MPI_DOUBLE,
+             MPI_SUM, 0, comm);
+  MPI_Reduce(&in->n_threads, &threads, 1, MPI_INT, MPI_SUM, 0, comm);
+
+  if (rank != 0) {
+    return;
+  }
+
+  Resumo fases[N_FASES], etapas[N_ETAPAS];
+  double comunicacao = 0.0;
+  for (int k = 0; k < N_FASES; k++) {
+    fases[k].min = fases[k].max = por_processo[k];
+    double soma = 0.0;
+    for (int r = 0; r < size; r++) {
+      double v = por_processo[r * N_FASES + k];
+      fases[k].min = (v < fases[k].min) ? v : fases[k].min;
+      fases[k].max = (v > fases[k].max) ? v : fases[k].max;
+      soma += v;
+    }
+    fases[k].media = soma / size;
+    if (fase_comunicacao[k]) {
+      comunicacao += fracao(&fases[k], tempo_total);
+    }
+  }
+  for (int e = 0; e < N_ETAPAS; e++) {
+    etapas[e].min = e_min[e];
+    etapas[e].max = e_max[e];
+    etapas[e].media = e_soma[e] / threads;
+  }
+
+  printf("\nFases do ciclo (segundos: minimo / media / maximo entre "
+         "processos, %% do total):\n");
+  for (int k = 0; k < N_FASES; k++) {
+    printf("  %-18s %9.4f / %9.4f / %9.4f  %5.1f%%\n", nomes_fase[k],
+           fases[k].min, fases[k].media, fases[k].max,
+           100.0 * fracao(&fases[k], tempo_total));
+  }
+  printf("Etapas de 5.3 por thread (%d threads ao todo):\n", threads);
+  for (int e = 0; e < N_ETAPAS; e++) {
+    printf("  %-18s %9.4f / %9.4f / %9.4f\n", nomes_etapa[e], etapas[e].min,
+           etapas[e].media, etapas[e].max);
+  }
+  printf("Fracao de comunicacao (5.1, 5.2, 5.4, 5.6): %.1f%%\n",
+         100.0 * comunicacao);
+
+  if (arquivo != NULL && arquivo[0] != '\0') {
+    FILE *f = fopen(arquivo, "w");
+    if (f == NULL) {
+      printf("Erro ao criar o relatorio %s\n", arquivo);
+    } else {
+      size_t n = strlen(arquivo);
+      if (n >= 5 && strcmp(arquivo + n - 5, ".json") == 0) {
+        gravar_json(f, fases, etapas, por_processo, size, threads, tempo_total,
+                    comunicacao);
+      } else {
+        gravar_csv(f, fases, etapas, tempo_total);
+      }
+      fclose(f);
+    }
+  }
+  free(por_processo);
+}
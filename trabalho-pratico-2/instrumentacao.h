@@ -0,0 +1,85 @@
+#ifndef INSTRUMENTACAO_H
+#define INSTRUMENTACAO_H
+
+#include <mpi.h>
+#include <omp.h>
+
+// Fases numeradas do ciclo (main.c), cronometradas em cada processo. A espera
+// pelo halo, que acontece dentro da região de agentes, é contada na fase 5.2.
+typedef enum {
+  FASE_ESTACAO,       // 5.1
+  FASE_HALO,          // 5.2
+  FASE_AGENTES,       // 5.3
+  FASE_MIGRACAO,      // 5.4
+  FASE_GRID,          // 5.5
+  FASE_METRICAS,      // 5.6
+  FASE_BALANCEAMENTO, // 5.7
+  FASE_VISUALIZACAO,  // 5.8
+  FASE_CHECKPOINT,    // 5.9
+  FASE_SNAPSHOT,      // 5.10
+  FASE_REORDENACAO,   // 5.11
+  N_FASES
+} Fase;
+
+// Etapas da região paralela de agentes, cronometradas em cada thread. As
+// barreiras entram na etapa que as precede, então a diferença entre threads
+// mostra o desbalanceamento interno do processo.
+typedef enum {
+  ETAPA_CARGA,
+  ETAPA_MOVIMENTO,
+  ETAPA_ESPERA_HALO,
+  ETAPA_CONSUMO,
+  ETAPA_ENERGIA,
+  ETAPA_COMPACTACAO,
+  N_ETAPAS
+} Etapa;
+
+// Etapas de uma thread ocupam uma linha de cache própria (sem falso
+// compartilhamento entre threads)
+#define PASSO_ETAPAS 8
+
+typedef struct {
+  double fase[N_FASES]; // Tempo acumulado por fase neste processo
+  double marca;         // Fim da última fase registrada
+  int n_threads;
+  double *etapa; // [n_threads * PASSO_ETAPAS], tempo acumulado por thread
+} Instrumentacao;
+
+// Assinaturas
+void instrumentacao_iniciar(Instrumentacao *in, int n_threads);
+void instrumentacao_liberar(Instrumentacao *in);
+
+// Coletiva. Agrega os tempos entre processos (mínimo, máximo e média) e, no
+// rank 0, imprime um resumo e grava o relatório em arquivo (JSON se o nome
+// terminar em ".json", CSV caso contrário; NULL ou "" = só o resumo).
+void instrumentacao_relatorio(const Instrumentacao *in, MPI_Comm comm,
+                              double tempo_total, const char *arquivo);
+
+// Marca o início do trecho cronometrado (o começo de um ciclo).
+static inline void instrumentacao_marcar(Instrumentacao *in) {
+  in->marca = MPI_Wtime();
+}
+
+// Atribui a f o tempo desde a última marca e marca de novo.
+static inline void instrumentacao_fase(Instrumentacao *in, Fase f) {
+  double agora = MPI_Wtime();
+  in->fase[f] += agora - in->marca;
+  in->marca = agora;
+}
+
+// Move um tempo já contado numa fase para outra.
+static inline void instrumentacao_transferir(Instrumentacao *in, Fase de,
+                                             Fase para, double tempo) {
+  in->fase[de] -= tempo;
+  in->fase[para] += tempo;
+}
+
+// Atribui à etapa e da thread tid o tempo desde marca; retorna a nova marca.
+static inline double instrumentacao_etapa(Instrumentacao *in, int tid, Etapa e,
+                                          double marca) {
+  double agora = omp_get_wtime();
+  in->etapa[tid * PASSO_ETAPAS + e] += agora - marca;
+  return agora;
+}
+
+#endif
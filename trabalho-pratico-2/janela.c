@@ -0,0 +1,196 @@
+#include "janela.h"
+#include <string.h>
+
+#define CAPACIDADE_FILA_INICIAL 1024
+
+// Fila de saída e contagens alocadas na janela, numa época passiva
+// permanente (as leituras dos vizinhos são ordenadas pelas barreiras).
+static void alocar_fila(Janela *j, int capacidade) {
+  MPI_Win_allocate_shared((MPI_Aint)capacidade * sizeof(Agente),
+                          sizeof(Agente), MPI_INFO_NULL, j->comm_no, &j->fila,
+                          &j->janela_fila);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, j->janela_fila);
+  j->capacidade_fila = capacidade;
+}
+
+static void liberar_fila(Janela *j) {
+  MPI_Win_unlock_all(j->janela_fila);
+  MPI_Win_free(&j->janela_fila);
+}
+
+void janela_iniciar(Janela *j, const Dominio *d, int ativa) {
+  j->ativa = ativa;
+  j->comm_no = MPI_COMM_NULL;
+  j->size_no = 1;
+  j->n_vizinhos_no = 0;
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    j->rank_no[dir] = -1;
+    j->vizinhos_msg[dir] = d->vizinhos[dir];
+  }
+  if (!ativa) {
+    return;
+  }
+
+  MPI_Comm_split_type(d->comm, MPI_COMM_TYPE_SHARED, d->rank, MPI_INFO_NULL,
+                      &j->comm_no);
+  MPI_Comm_size(j->comm_no, &j->size_no);
+
+  // Vizinhos que estão neste nó: saem da troca de mensagens
+  MPI_Group grupo_cart, grupo_no;
+  MPI_Comm_group(d->comm, &grupo_cart);
+  MPI_Comm_group(j->comm_no, &grupo_no);
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    if (d->vizinhos[dir] == MPI_PROC_NULL) {
+      continue;
+    }
+    int r;
+    MPI_Group_translate_ranks(grupo_cart, 1, &d->vizinhos[dir], grupo_no, &r);
+    if (r != MPI_UNDEFINED) {
+      j->rank_no[dir] = r;
+      j->vizinhos_msg[dir] = MPI_PROC_NULL;
+      j->n_vizinhos_no++;
+    }
+  }
+  MPI_Group_free(&grupo_cart);
+  MPI_Group_free(&grupo_no);
+
+  MPI_Win_allocate_shared(2 * N_DIRECOES * sizeof(int), sizeof(int),
+                          MPI_INFO_NULL, j->comm_no, &j->contagens,
+                          &j->janela_contagens);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, j->janela_contagens);
+  memset(j->contagens, 0, 2 * N_DIRECOES * sizeof(int));
+  alocar_fila(j, CAPACIDADE_FILA_INICIAL);
+}
+
+void janela_liberar(Janela *j) {
+  if (!j->ativa) {
+    return;
+  }
+  liberar_fila(j);
+  MPI_Win_unlock_all(j->janela_contagens);
+  MPI_Win_free(&j->janela_contagens);
+  MPI_Comm_free(&j->comm_no);
+}
+
+// Barreira no nó com as escritas locais da janela visíveis antes dela e as
+// dos outros processos visíveis depois.
+static void sincronizar(const Janela *j, MPI_Win janela) {
+  MPI_Win_sync(janela);
+  MPI_Barrier(j->comm_no);
+  MPI_Win_sync(janela);
+}
+
+// Início do plano de recurso do processo de rank r em comm_no.
+static const double *plano_de(const Grid *g, int r) {
+  MPI_Aint tamanho;
+  int unidade;
+  double *base;
+  MPI_Win_shared_query(g->janela, r, &tamanho, &unidade, &base);
+  return base;
+}
+
+void janela_iniciar_halo(const Janela *j, const Dominio *d, double *plano,
+                         MPI_Request req[2 * N_DIRECOES]) {
+  dominio_iniciar_halo_com(d, j->vizinhos_msg, plano, req);
+}
+
+// O halo do lado op recebe a borda que o vizinho desse lado manda na direção
+// dir (para cá). O vizinho tem a mesma largura (N/S) ou altura (O/L) deste
+// bloco; só o passo das linhas dele pode ser outro.
+static void copiar_regiao(const Dominio *d, Direcao dir, const double *origem,
+                          double *plano) {
+  Direcao op = direcao_oposta(dir);
+  int cy = d->coords[0] + DIR_DY[op], cx = d->coords[1] + DIR_DX[op];
+  int W_vizinho = d->limites_x[cx + 1] - d->limites_x[cx];
+  int H_vizinho = d->limites_y[cy + 1] - d->limites_y[cy];
+  int dx = DIR_DX[dir], dy = DIR_DY[dir];
+  int x = (dx > 0) ? W_vizinho - 1 : 0;
+  int y = (dy > 0) ? H_vizinho - 1 : 0;
+  const double *de = &origem[(y + 1) * (W_vizinho + 2) + (x + 1)];
+  double *para = &plano[d->idx_recepcao[op]];
+
+  if (dx == 0) {
+    memcpy(para, de, d->W_local * sizeof(double));
+  } else if (dy == 0) {
+    for (int k = 0; k < d->H_local; k++) {
+      para[k * (d->W_local + 2)] = de[k * (W_vizinho + 2)];
+    }
+  } else {
+    *para = *de;
+  }
+}
+
+void janela_concluir_halo(const Janela *j, const Dominio *d, const Grid *g,
+                          MPI_Request req[2 * N_DIRECOES]) {
+  if (j->ativa) {
+    // Bordas dos vizinhos do nó já regeneradas no ciclo anterior
+    sincronizar(j, g->janela);
+    for (int dir = 0; dir < N_DIRECOES; dir++) {
+      int r = j->rank_no[direcao_oposta(dir)];
+      if (r >= 0) {
+        copiar_regiao(d, (Direcao)dir, plano_de(g, r), g->recurso);
+      }
+    }
+  }
+  dominio_concluir_halo(req);
+  if (j->ativa) {
+    // Ninguém regenera a própria borda antes que todos a tenham lido
+    MPI_Barrier(j->comm_no);
+  }
+}
+
+Agente *janela_reservar_fila(Janela *j, int n) {
+  int maior;
+  MPI_Allreduce(&n, &maior, 1, MPI_INT, MPI_MAX, j->comm_no);
+  if (maior > j->capacidade_fila) {
+    // Mesmo critério de crescimento dos buffers de pool.c
+    int nova = j->capacidade_fila;
+    while (nova < maior) {
+      nova *= 2;
+    }
+    liberar_fila(j);
+    alocar_fila(j, nova);
+    pool_contar_realocacao();
+  }
+  return j->fila;
+}
+
+void janela_publicar_contagens(Janela *j, const int contagem[N_DIRECOES],
+                               const int desloc[N_DIRECOES]) {
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    j->contagens[dir] = contagem[dir];
+    j->contagens[N_DIRECOES + dir] = desloc[dir];
+  }
+}
+
+int janela_receber_agentes(const Janela *j, BufferAgentes *recebidos) {
+  MPI_Win_sync(j->janela_contagens);
+  sincronizar(j, j->janela_fila);
+  MPI_Win_sync(j->janela_contagens);
+
+  int total = 0;
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    int r = j->rank_no[dir];
+    if (r < 0) {
+      continue;
+    }
+    // O vizinho do lado dir manda para cá pela direção oposta
+    Direcao op = direcao_oposta(dir);
+    MPI_Aint tamanho;
+    int unidade;
+    const int *contagens;
+    const Agente *fila;
+    MPI_Win_shared_query(j->janela_contagens, r, &tamanho, &unidade,
+                         &contagens);
+    MPI_Win_shared_query(j->janela_fila, r, &tamanho, &unidade, &fila);
+    int cont = contagens[op];
+    buffer_reservar(recebidos, recebidos->n + cont);
+    memcpy(recebidos->dados + recebidos->n, fila + contagens[N_DIRECOES + op],
+           cont * sizeof(Agente));
+    recebidos->n += cont;
+    total += cont;
+  }
+  return total;
+}
+
+void janela_liberar_filas(const Janela *j) { MPI_Barrier(j->comm_no); }
@@ -0,0 +1,65 @@
+#ifndef JANELA_H
+#define JANELA_H
+
+#include <mpi.h>
+
+#include "dominio.h"
+#include "grid.h"
+#include "pool.h"
+
+// Comunicação com os vizinhos do mesmo nó por memória compartilhada
+// (--memoria-compartilhada). Os processos de um nó formam comm_no
+// (MPI_Comm_split_type com MPI_COMM_TYPE_SHARED). O plano de recurso de cada
+// um fica numa janela MPI_Win_allocate_shared (ver grid.h), e os agentes que
+// saem, numa fila também compartilhada. Um vizinho do mesmo nó lê a borda e
+// a fila direto da memória do outro; só os de outros nós recebem mensagens.
+//
+// A leitura é protegida por duas barreiras em comm_no: a primeira garante
+// que os dados dos vizinhos estão prontos, a segunda que todos já leram
+// antes que alguém volte a escrever.
+typedef struct {
+  int ativa;
+  MPI_Comm comm_no; // MPI_COMM_NULL se desligada
+  int size_no;
+
+  // Rank em comm_no do vizinho de cada direção, ou -1 se ele está em outro
+  // nó (ou não existe); e os vizinhos que continuam trocando mensagens
+  // (MPI_PROC_NULL nas direções do mesmo nó)
+  int rank_no[N_DIRECOES];
+  int vizinhos_msg[N_DIRECOES];
+  int n_vizinhos_no;
+
+  // Contagem e deslocamento por direção da fila de saída deste processo
+  MPI_Win janela_contagens;
+  int *contagens; // [2 * N_DIRECOES]
+
+  // Fila de saída: mesmo formato AoS do buffer de envio da migração
+  MPI_Win janela_fila;
+  Agente *fila;
+  int capacidade_fila;
+} Janela;
+
+// Assinaturas
+void janela_iniciar(Janela *j, const Dominio *d, int ativa);
+void janela_liberar(Janela *j);
+
+// Halo: as direções do mesmo nó são copiadas direto do plano do vizinho em
+// janela_concluir_halo(); as outras seguem em mensagens, como em dominio.c.
+void janela_iniciar_halo(const Janela *j, const Dominio *d, double *plano,
+                         MPI_Request req[2 * N_DIRECOES]);
+void janela_concluir_halo(const Janela *j, const Dominio *d, const Grid *g,
+                          MPI_Request req[2 * N_DIRECOES]);
+
+// Fila de saída com pelo menos n agentes, na janela compartilhada. Coletiva
+// no nó: se algum processo precisar de mais espaço, todos realocam.
+Agente *janela_reservar_fila(Janela *j, int n);
+void janela_publicar_contagens(Janela *j, const int contagem[N_DIRECOES],
+                               const int desloc[N_DIRECOES]);
+
+// Copia para o fim de recebidos os agentes que os vizinhos do nó puseram nas
+// filas na direção deste processo, em ordem fixa de direção. Retorna quantos.
+// As filas só podem ser escritas de novo depois de janela_liberar_filas().
+int janela_receber_agentes(const Janela *j, BufferAgentes *recebidos);
+void janela_liberar_filas(const Janela *j);
+
+#endif
@@ -1,30 +1,195 @@
 #include "logger.h"
-#include <stdio.h>
-
-void iniciar_log(const char *nome_arquivo) {
-  // Abre no modo "w" (write) para apagar o log da execução anterior e começar
-  // limpo
-  FILE *f = fopen(nome_arquivo, "w");
-  if (f != NULL) {
-    fprintf(f, "=== HISTÓRICO DA SIMULAÇÃO (MPI + OpenMP) ===\n");
+#include <stdlib.h>
+#include <string.h>
+
+#define ASSINATURA_BINARIO "SIMLOG01" // 8 bytes no início do arquivo binário
+
+static const char *nomes_formato[] = {"texto", "csv", "binario", "nenhum"};
+static const char *arquivos_padrao[] = {"log.txt", "log.csv", "log.bin",
+                                        NULL};
+
+int logger_formato_de(const char *nome, FormatoLog *formato) {
+  for (int k = 0; k <= LOG_DESLIGADO; k++) {
+    if (strcmp(nome, nomes_formato[k]) == 0) {
+      *formato = (FormatoLog)k;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *logger_nome_formato(FormatoLog formato) {
+  return nomes_formato[formato];
+}
+
+const char *logger_arquivo_padrao(FormatoLog formato) {
+  return arquivos_padrao[formato];
+}
+
+static void escrever_cabecalho(Logger *l) {
+  switch (l->formato) {
+  case LOG_TEXTO:
+    fprintf(l->arquivo, "=== HISTÓRICO DA SIMULAÇÃO (MPI + OpenMP) ===\n");
     fprintf(
-        f,
+        l->arquivo,
         "Ciclo | Estação | População Total | Energia Total | Recurso Total\n");
     fprintf(
-        f, "---------------------------------------------------------------\n");
-    fclose(f);
-  } else {
-    printf("Erro ao criar o arquivo de log!\n");
+        l->arquivo,
+        "---------------------------------------------------------------\n");
+    break;
+  case LOG_CSV:
+    fprintf(l->arquivo, "ciclo,estacao,populacao,energia,recursos\n");
+    break;
+  case LOG_BINARIO: {
+    uint32_t tamanho = sizeof(RegistroLog);
+    fwrite(ASSINATURA_BINARIO, 1, 8, l->arquivo);
+    fwrite(&tamanho, sizeof(tamanho), 1, l->arquivo);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+static void escrever_lote(Logger *l, const RegistroLog *r, int n) {
+  if (l->formato == LOG_BINARIO) {
+    fwrite(r, sizeof(RegistroLog), n, l->arquivo);
+    return;
+  }
+  for (int k = 0; k < n; k++) {
+    const char *estacao = (r[k].estacao == SECA ? "SECA" : "CHEIA");
+    if (l->formato == LOG_TEXTO) {
+      fprintf(l->arquivo, "%5d | %7s | %15lld | %13.2f | %13.2f\n",
+              r[k].ciclo, estacao, (long long)r[k].populacao, r[k].energia,
+              r[k].recursos);
+    } else {
+      fprintf(l->arquivo, "%d,%s,%lld,%.6f,%.6f\n", r[k].ciclo, estacao,
+              (long long)r[k].populacao, r[k].energia, r[k].recursos);
+    }
+  }
+}
+
+static void reservar_registros(RegistroLog **v, int *capacidade, int n) {
+  if (n > *capacidade) {
+    int nova = (*capacidade > 0) ? *capacidade : 64;
+    while (nova < n) {
+      nova *= 2;
+    }
+    *v = (RegistroLog *)realloc(*v, nova * sizeof(RegistroLog));
+    if (*v == NULL) {
+      printf("Erro fatal de memoria no buffer do log (%d registros)!\n", nova);
+      abort();
+    }
+    *capacidade = nova;
+  }
+}
+
+// Thread de escrita: dorme até haver um lote cheio (ou o encerramento),
+// troca de lote com a simulação e grava sem segurar a trava.
+static void *escritor(void *arg) {
+  Logger *l = (Logger *)arg;
+
+  pthread_mutex_lock(&l->trava);
+  for (;;) {
+    while (!l->encerrar && l->n_pendentes < l->descarga) {
+      pthread_cond_wait(&l->sinal, &l->trava);
+    }
+    int n = l->n_pendentes;
+    if (n == 0 && l->encerrar) {
+      break;
+    }
+
+    RegistroLog *lote = l->pendentes;
+    int capacidade = l->capacidade_pendentes;
+    l->pendentes = l->gravando;
+    l->capacidade_pendentes = l->capacidade_gravando;
+    l->n_pendentes = 0;
+    l->gravando = lote;
+    l->capacidade_gravando = capacidade;
+
+    pthread_mutex_unlock(&l->trava);
+    escrever_lote(l, lote, n);
+    fflush(l->arquivo);
+    pthread_mutex_lock(&l->trava);
+  }
+  pthread_mutex_unlock(&l->trava);
+  return NULL;
+}
+
+// Abre (truncando) o arquivo e inicia a thread de escrita. descarga é o
+// tamanho do lote que acorda a escrita (1 = a cada registro). Retorna 0 em
+// caso de sucesso; com LOG_DESLIGADO nada é aberto.
+int logger_abrir(Logger *l, const char *nome_arquivo, FormatoLog formato,
+                 int descarga, int acrescentar) {
+  memset(l, 0, sizeof(*l));
+  l->formato = formato;
+  l->descarga = (descarga > 0) ? descarga : 1;
+  if (formato == LOG_DESLIGADO) {
+    return 0;
+  }
+
+  const char *modo = acrescentar ? "a" : "w";
+  if (formato == LOG_BINARIO) {
+    modo = acrescentar ? "ab" : "wb";
+  }
+  l->arquivo = fopen(nome_arquivo, modo);
+  if (l->arquivo == NULL) {
+    printf("Erro ao criar o arquivo de log %s!\n", nome_arquivo);
+    return -1;
   }
+  fseek(l->arquivo, 0, SEEK_END);
+  if (ftell(l->arquivo) == 0) {
+    escrever_cabecalho(l);
+  }
+
+  reservar_registros(&l->pendentes, &l->capacidade_pendentes, l->descarga);
+  reservar_registros(&l->gravando, &l->capacidade_gravando, l->descarga);
+  pthread_mutex_init(&l->trava, NULL);
+  pthread_cond_init(&l->sinal, NULL);
+  if (pthread_create(&l->escritor, NULL, escritor, l) != 0) {
+    printf("Erro ao criar a thread de escrita do log!\n");
+    fclose(l->arquivo);
+    l->arquivo = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+// Só copia o registro para o lote em memória; se a escrita estiver atrasada,
+// o lote cresce em vez de bloquear a simulação.
+void logger_registrar(Logger *l, int ciclo, Estacao estacao, long long populacao,
+                      double energia, double recursos) {
+  if (l->arquivo == NULL) {
+    return;
+  }
+
+  RegistroLog r = {ciclo, (int32_t)estacao, populacao, energia, recursos};
+  pthread_mutex_lock(&l->trava);
+  reservar_registros(&l->pendentes, &l->capacidade_pendentes,
+                     l->n_pendentes + 1);
+  l->pendentes[l->n_pendentes++] = r;
+  if (l->n_pendentes >= l->descarga) {
+    pthread_cond_signal(&l->sinal);
+  }
+  pthread_mutex_unlock(&l->trava);
 }
 
-void registrar_log_ciclo(const char *nome_arquivo, int ciclo, Estacao estacao,
-                         int populacao, double energia, double recursos) {
-  // Abre no modo "a" (append) para adicionar a nova linha no final do arquivo
-  FILE *f = fopen(nome_arquivo, "a");
-  if (f != NULL) {
-    fprintf(f, "%5d | %7s | %15d | %13.2f | %13.2f\n", ciclo,
-            (estacao == SECA ? "SECA" : "CHEIA"), populacao, energia, recursos);
-    fclose(f);
+// Grava o que restou em memória, encerra a thread e fecha o arquivo.
+void logger_fechar(Logger *l) {
+  if (l->arquivo == NULL) {
+    return;
   }
+
+  pthread_mutex_lock(&l->trava);
+  l->encerrar = 1;
+  pthread_cond_signal(&l->sinal);
+  pthread_mutex_unlock(&l->trava);
+  pthread_join(l->escritor, NULL);
+
+  fclose(l->arquivo);
+  l->arquivo = NULL;
+  pthread_mutex_destroy(&l->trava);
+  pthread_cond_destroy(&l->sinal);
+  free(l->pendentes);
+  free(l->gravando);
 }
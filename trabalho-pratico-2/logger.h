@@ -1,11 +1,62 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
 #include "grid.h"
 
-// Assinaturas das funções
-void iniciar_log(const char *nome_arquivo);
-void registrar_log_ciclo(const char *nome_arquivo, int ciclo, Estacao estacao,
-                         int populacao, double energia, double recursos);
+typedef enum {
+  LOG_TEXTO,   // Tabela legível (o formato original de log.txt)
+  LOG_CSV,     // Uma linha por ciclo, separada por vírgulas
+  LOG_BINARIO, // Cabeçalho seguido dos registros crus (RegistroLog)
+  LOG_DESLIGADO,
+} FormatoLog;
+
+// Um registro por amostra de métricas. Campos de largura fixa e sem padding
+// (32 bytes), gravados como estão no formato binário.
+typedef struct {
+  int32_t ciclo;
+  int32_t estacao;
+  int64_t populacao;
+  double energia;
+  double recursos;
+} RegistroLog;
+
+// Log com escrita em segundo plano: o arquivo fica aberto a execução toda,
+// logger_registrar() só copia o registro para a memória e uma thread de
+// escrita formata e grava os lotes acumulados. Assim o rank 0 não faz E/S de
+// disco no caminho crítico do ciclo.
+typedef struct {
+  FILE *arquivo;
+  FormatoLog formato;
+  int descarga; // Registros acumulados antes de acordar a escrita
+
+  // Lote sendo preenchido pela simulação; a escrita troca-o pelo seu, já
+  // vazio, sob a trava, e grava fora dela
+  RegistroLog *pendentes;
+  int n_pendentes, capacidade_pendentes;
+  RegistroLog *gravando;
+  int capacidade_gravando;
+
+  pthread_t escritor;
+  pthread_mutex_t trava;
+  pthread_cond_t sinal;
+  int encerrar;
+} Logger;
+
+// Assinaturas
+int logger_formato_de(const char *nome, FormatoLog *formato);
+const char *logger_nome_formato(FormatoLog formato);
+const char *logger_arquivo_padrao(FormatoLog formato);
+// Com acrescentar (reinício de um checkpoint), os registros vão para o fim
+// do log existente em vez de apagá-lo; o cabeçalho só é escrito num arquivo
+// vazio.
+int logger_abrir(Logger *l, const char *nome_arquivo, FormatoLog formato,
+                 int descarga, int acrescentar);
+void logger_registrar(Logger *l, int ciclo, Estacao estacao, long long populacao,
+                      double energia, double recursos);
+void logger_fechar(Logger *l);
 
 #endif
@@ -8,27 +8,101 @@
 
 // Importando os nossos próprios módulos
 #include "agente.h"
+#include "balanceamento.h"
+#include "checkpoint.h"
+#include "config.h"
+#include "dominio.h"
 #include "grid.h"
+#include "instrumentacao.h"
+#include "janela.h"
 #include "logger.h"
+#include "metricas.h"
+#include "migracao.h"
+#include "numa.h"
+#include "ocupacao.h"
+#include "ordenacao.h"
+#include "pool.h"
+#include "populacao.h"
+#include "rng.h"
+#include "snapshot.h"
 #include "visualizacao.h"
 
-#define T_TOTAL 100  // Ciclos totais
-#define S_SAZONAL 10 // Ciclos por estação
+// Granularidade das tarefas do ciclo: agentes por tarefa de movimento e
+// células (linhas inteiras) por tarefa de regeneração do grid
+#define AGENTES_POR_TAREFA 4096
+#define CELULAS_POR_TAREFA 16384
+#define TRECHOS_POR_THREAD 8 // Tarefas de carga por thread no modo "custo"
+
+// Limites de movimento: onde não há vizinho a parede global segura o agente.
+static Paredes montar_paredes(const Dominio *d) {
+  Paredes paredes;
+  paredes.W_local = d->W_local;
+  paredes.H_local = d->H_local;
+  paredes.passo = d->W_local + 2;
+  paredes.min_x = (d->vizinhos[DIR_O] == MPI_PROC_NULL) ? 0 : -1;
+  paredes.max_x =
+      (d->vizinhos[DIR_L] == MPI_PROC_NULL) ? d->W_local - 1 : d->W_local;
+  paredes.min_y = (d->vizinhos[DIR_N] == MPI_PROC_NULL) ? 0 : -1;
+  paredes.max_y =
+      (d->vizinhos[DIR_S] == MPI_PROC_NULL) ? d->H_local - 1 : d->H_local;
+  return paredes;
+}
+
+// Imprime (a cada 10 amostras) e registra no log as métricas globais de uma
+// redução concluída. Só o rank 0 tem os totais.
+static void reportar_metricas(const ReducaoMetricas *r, int metricas_cada,
+                              Logger *log) {
+  const Metricas *m = &r->global;
+  if ((r->ciclo / metricas_cada) % 10 == 0) {
+    printf("\n=== ESTATÍSTICAS GLOBAIS - CICLO %d ===\n", r->ciclo);
+    printf("Estação atual: %s\n", (r->estacao == SECA ? "SECA" : "CHEIA"));
+    printf("População Total (Agentes): %lld\n", m->agentes);
+    printf("Energia Acumulada: %.2f\n", m->energia);
+    printf("Recursos Globais do Território: %.2f\n", m->recurso);
+    printf("=======================================\n");
+  }
+
+  logger_registrar(log, r->ciclo, r->estacao, m->agentes, m->energia,
+                   m->recurso);
+}
+
+// Sorteia a posição global de nascimento do agente i e diz se ela cai no
+// bloco de d.
+static bool nasce_no_bloco(unsigned int semente, const Dominio *d, int i,
+                           int *gx, int *gy) {
+  uint64_t r = rng_agente(semente, i, 0, RNG_FLUXO_NASCIMENTO);
+  *gx = (int)rng_intervalo((uint32_t)r, d->W_global);
+  *gy = (int)rng_intervalo((uint32_t)(r >> 32), d->H_global);
+  return *gx >= d->offsetX && *gx < d->offsetX + d->W_local &&
+         *gy >= d->offsetY && *gy < d->offsetY + d->H_local;
+}
 
 int main(int argc, char **argv) {
   // 1. Inicialização do Ambiente
-  MPI_Init(&argc, &argv);
+  // FUNNELED: só a thread mestre chama MPI, mas pode fazê-lo de dentro de uma
+  // região paralela (o laço de ciclos inteiro roda numa só; a mestre se
+  // comunica enquanto as outras threads executam as tarefas de cálculo)
+  // Antes de tudo, as threads são fixadas conforme --afinidade (o que pode
+  // reexecutar o programa com OMP_PROC_BIND/OMP_PLACES definidos)
+  numa_aplicar_afinidade(argc, argv);
+  int nivel_thread;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &nivel_thread);
+  if (nivel_thread < MPI_THREAD_FUNNELED) {
+    fprintf(stderr, "A biblioteca MPI nao oferece MPI_THREAD_FUNNELED\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
 
   // Definição do Tipo Derivado MPI para a struct Agente
   MPI_Datatype mpi_agente_type;
-  int blocklengths[3] = {2, 2, 1}; // {x, y}, {gx, gy}, {energia}
-  MPI_Aint displacements[3];
+  int blocklengths[4] = {2, 2, 1, 1}; // {x, y}, {gx, gy}, {energia}, {id}
+  MPI_Aint displacements[4];
   displacements[0] = offsetof(Agente, x);
   displacements[1] = offsetof(Agente, gx);
   displacements[2] = offsetof(Agente, energia);
-  MPI_Datatype types[3] = {MPI_INT, MPI_INT, MPI_DOUBLE};
+  displacements[3] = offsetof(Agente, id);
+  MPI_Datatype types[4] = {MPI_INT, MPI_INT, MPI_DOUBLE, MPI_UINT64_T};
 
-  MPI_Type_create_struct(3, blocklengths, displacements, types,
+  MPI_Type_create_struct(4, blocklengths, displacements, types,
                          &mpi_agente_type);
   MPI_Type_commit(&mpi_agente_type);
 
@@ -36,364 +110,963 @@ int main(int argc, char **argv) {
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   MPI_Comm_size(MPI_COMM_WORLD, &size);
 
+  // Parâmetros de execução (linha de comando e/ou arquivo de configuração)
+  Config cfg;
+  config_padrao(&cfg);
+  if (config_ler_argumentos(&cfg, argc, argv) != 0) {
+    if (rank == 0) {
+      config_imprimir_uso(argv[0]);
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // Reinício: a geometria, a semente, o ciclo e a estação vêm do checkpoint;
+  // as demais opções (inclusive o total de ciclos) da linha de comando
+  CabecalhoCheckpoint cabecalho;
+  int reiniciar = (cfg.reiniciar[0] != '\0');
+  if (reiniciar) {
+    if (checkpoint_ler_cabecalho(cfg.reiniciar, MPI_COMM_WORLD, &cabecalho) !=
+        0) {
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    cfg.largura = cabecalho.largura;
+    cfg.altura = cabecalho.altura;
+    cfg.semente = cabecalho.semente;
+    cfg.n_agentes = (int)cabecalho.n_agentes;
+  }
+  if (rank == 0) {
+    config_imprimir(&cfg);
+  }
+
   // Dimensões Globais
-  int W_global = 20;
-  int H_global = 20;
-  int n_agentes_total = 100; // Exemplo
-
-  // Particionamento (Decomposição de Domínio)
-  int W_local = W_global;
-  int H_local = H_global / size;
-
-  // Offsets para situar o subgrid no mundo global
-  int offsetX = 0;
-  int offsetY = rank * H_local;
-
-  // Alocação do Grid Local
-  Celula *grid_local = (Celula *)malloc(W_local * H_local * sizeof(Celula));
-
-  // Inicialização do Grid (Garantindo continuidade global)
-  for (int j = 0; j < H_local; j++) {
-    for (int i = 0; i < W_local; i++) {
-      int gx = offsetX + i;
-      int gy = offsetY + j;
-
-      int idx = j * W_local + i;
-      grid_local[idx].tipo = f_tipo(gx, gy);
-      grid_local[idx].recurso = f_recurso(grid_local[idx].tipo);
-      grid_local[idx].acessivel = true;
+  int W_global = cfg.largura;
+  int H_global = cfg.altura;
+  int n_agentes_total = cfg.n_agentes;
+
+  // Particionamento (Decomposição de Domínio 2D em topologia cartesiana)
+  Dominio dom;
+  if (dominio_criar(&dom, MPI_COMM_WORLD, W_global, H_global, cfg.procs_x,
+                    cfg.procs_y) != 0) {
+    if (rank == 0) {
+      fprintf(stderr,
+              "Nao foi possivel decompor o grid %dx%d em %d processos "
+              "(procs-x %d, procs-y %d)\n",
+              W_global, H_global, size, cfg.procs_x, cfg.procs_y);
     }
+    MPI_Abort(MPI_COMM_WORLD, 1);
   }
+  // A partir daqui toda a comunicação usa o comunicador cartesiano, cujo
+  // rank pode diferir do de MPI_COMM_WORLD
+  MPI_Comm comm = dom.comm;
+  rank = dom.rank;
+  int W_local = dom.W_local;
+  int H_local = dom.H_local;
+
+  // Offsets para situar o subgrid no mundo global (junto com o tamanho,
+  // atualizados quando o balanceamento reparte o domínio)
+  int offsetX = dom.offsetX;
+  int offsetY = dom.offsetY;
+
+  // Alocação do Grid Local (planos de tipo/recurso/acessibilidade com anel
+  // de halo)
+  // Com --memoria-compartilhada, os vizinhos do mesmo nó trocam halo e
+  // agentes pela memória (o plano de recurso fica numa janela do nó)
+  Janela janela;
+  janela_iniciar(&janela, &dom, cfg.memoria_compartilhada);
+  Grid grid;
+  grid_iniciar(&grid, dominio_celulas_com_halo(&dom), cfg.taxa_seca,
+               cfg.taxa_cheia, cfg.consumo, cfg.terreno, janela.comm_no);
+
+  // Inicialização do Grid (Garantindo continuidade global): tipo e recurso
+  // cheio de cada célula, inclusive no halo
+  grid_preencher(&grid, &dom);
 
   // 4. Inicialização de Agentes Locais
-  int n_agentes_locais = n_agentes_total / size;
-  int capacidade_agentes =
-      n_agentes_locais +
-      1000; // Margem de sobra para evitar reallocs excessivos
-  Agente *lista_agentes = (Agente *)malloc(capacidade_agentes * sizeof(Agente));
-
-  srand(42 + rank); // Semente diferente por processo para agentes não nascerem
-                    // no mesmo lugar
-  for (int i = 0; i < n_agentes_locais; i++) {
-    lista_agentes[i].gx = rand() % W_global;
-    lista_agentes[i].gy =
-        offsetY + (rand() % H_local); // Garante que nasce no meu território
-    lista_agentes[i].x = lista_agentes[i].gx - offsetX;
-    lista_agentes[i].y = lista_agentes[i].gy - offsetY;
-    lista_agentes[i].energia = 100.0; // Energia inicial cheia
+  // A posição inicial do agente de id i é sorteada pelo gerador baseado em
+  // contador, no grid global; cada processo percorre todos os ids e fica com
+  // os que nascem no seu bloco. Assim o estado inicial não depende do número
+  // de processos.
+  // A população local fica em SoA com buffer duplo: o laço de agentes lê de
+  // "atual" e escreve os que ficam no bloco em "proxima"; depois elas trocam.
+  Populacao populacoes[2];
+  populacao_iniciar(&populacoes[0], n_agentes_total / size +
+                                        1000); // Margem para evitar reallocs
+  populacao_iniciar(&populacoes[1], populacoes[0].capacidade);
+  Populacao *atual = &populacoes[0];
+  Populacao *proxima = &populacoes[1];
+
+  Checkpoint checkpoint;
+  checkpoint_iniciar(&checkpoint);
+  int ciclo_inicial = 0;
+  Estacao estacao_atual = SECA;
+
+  if (reiniciar) {
+    // Recurso e agentes do checkpoint, redistribuídos para esta decomposição
+    double inicio_leitura = MPI_Wtime();
+    checkpoint_carregar(&checkpoint, cfg.reiniciar, &cabecalho, &dom, &grid,
+                        atual, proxima, mpi_agente_type);
+    ciclo_inicial = cabecalho.ciclo;
+    estacao_atual = (Estacao)cabecalho.estacao;
+    if (rank == 0) {
+      printf("[Checkpoint] Retomando do ciclo %d a partir de %s (%lld "
+             "agentes, %.4f segundos de leitura)\n",
+             ciclo_inicial, cfg.reiniciar, (long long)cabecalho.n_agentes,
+             MPI_Wtime() - inicio_leitura);
+    }
+  } else {
+    // Cada thread sorteia um trecho estático dos ids e conta os que nascem no
+    // bloco, no interior e na borda; com a soma de prefixos por (trecho,
+    // thread), a segunda passada escreve a população já em [interior |
+    // borda] (invariante mantido pela compactação), cada thread na faixa que
+    // ela mesma percorre depois (first touch).
+    int *nascidos = (int *)calloc(2 * omp_get_max_threads(), sizeof(int));
+#pragma omp parallel
+    {
+      int tid = omp_get_thread_num();
+      int nt = omp_get_num_threads();
+      int ini, fim;
+      populacao_faixa(n_agentes_total, nt, tid, &ini, &fim);
+      int *meus = &nascidos[2 * tid]; // [interior, borda]
+      for (int i = ini; i < fim; i++) {
+        int gx, gy;
+        if (nasce_no_bloco(cfg.semente, &dom, i, &gx, &gy)) {
+          meus[populacao_na_borda(gx - offsetX, gy - offsetY, W_local,
+                                  H_local)]++;
+        }
+      }
+#pragma omp barrier
+#pragma omp single
+      {
+        int n_interior_inicial = 0;
+        for (int k = 0; k < nt; k++) {
+          n_interior_inicial += nascidos[2 * k];
+        }
+        int pos[2] = {0, n_interior_inicial};
+        for (int k = 0; k < nt; k++) {
+          for (int trecho = 0; trecho < 2; trecho++) {
+            int cont = nascidos[2 * k + trecho];
+            nascidos[2 * k + trecho] = pos[trecho];
+            pos[trecho] += cont;
+          }
+        }
+        populacao_reservar(atual, pos[1]);
+        atual->n = pos[1];
+        atual->n_interior = n_interior_inicial;
+      }
+
+      for (int i = ini; i < fim; i++) {
+        int gx, gy;
+        if (!nasce_no_bloco(cfg.semente, &dom, i, &gx, &gy)) {
+          continue; // Nasce no território de outro processo
+        }
+        int x = gx - offsetX, y = gy - offsetY;
+        int k = meus[populacao_na_borda(x, y, W_local, H_local)]++;
+        atual->id[k] = (uint64_t)i;
+        atual->gx[k] = gx;
+        atual->gy[k] = gy;
+        atual->x[k] = x;
+        atual->y[k] = y;
+        atual->energia[k] = 100.0; // Energia inicial cheia
+      }
+    }
+    free(nascidos);
   }
 
-  // Apenas o Rank 0 inicializa o ficheiro de log, apagando execuções anteriores
-  if (rank == 0) {
-    iniciar_log("log.txt");
+  // Regeneração adiada: daqui em diante o recurso de cada célula vale junto
+  // com o ciclo em que ela foi atualizada por último (ver grid.h)
+  if (cfg.regeneracao == REGENERACAO_ADIADA) {
+    grid_adiar(&grid, &dom, ciclo_inicial, cfg.ciclos, estacao_atual,
+               cfg.ciclos_estacao);
+  }
+
+  // Índice de ocupação (agentes agrupados por célula), refeito nos ciclos em
+  // que alguma etapa consulta a ocupação das células
+  Ocupacao ocupacao;
+  ocupacao_iniciar(&ocupacao);
+
+  // Áreas de trabalho da reordenação periódica dos agentes
+  Ordenacao ordenacao;
+  ordenacao_iniciar(&ordenacao);
+
+  // Apenas o Rank 0 abre o ficheiro de log, apagando execuções anteriores (ou,
+  // ao retomar de um checkpoint, continuando o histórico gravado antes
+  // dele). A gravação fica com uma thread de escrita em segundo plano.
+  Logger log;
+  log.arquivo = NULL;
+  if (rank == 0 &&
+      logger_abrir(&log, logger_arquivo_padrao(cfg.log_formato),
+                   cfg.log_formato, cfg.log_descarga, reiniciar) != 0) {
+    MPI_Abort(MPI_COMM_WORLD, 1);
   }
 
-  printf("[Processo %d] Grid inicializado. OffsetY: %d, Agentes: %d\n", rank,
-         offsetY, n_agentes_locais);
+  printf("[Processo %d] Grid inicializado. Bloco (%d,%d) de %dx%d, "
+         "Offset: (%d,%d), Tamanho: %dx%d, Agentes: %d\n",
+         rank, dom.coords[1], dom.coords[0], dom.dims[1], dom.dims[0],
+         offsetX, offsetY, W_local, H_local, atual->n);
+  if (janela.ativa) {
+    int n_vizinhos = 0;
+    for (int dir = 0; dir < N_DIRECOES; dir++) {
+      n_vizinhos += (dom.vizinhos[dir] != MPI_PROC_NULL);
+    }
+    printf("[Processo %d] Memoria compartilhada: %d processos no no, %d de "
+           "%d vizinhos no mesmo no\n",
+           rank, janela.size_no, janela.n_vizinhos_no, n_vizinhos);
+  }
 
-  Estacao estacao_atual = SECA;
+  // Buffers persistentes de migração (formato AoS de troca): o de envio fica
+  // no estado da migração, agrupado por direção, e um para os que chegam. São
+  // alocados uma única vez, reaproveitados a cada ciclo e crescem sob demanda.
+  int n_threads = omp_get_max_threads();
+  Migracao mig;
+  migracao_iniciar(&mig, &dom, cfg.migracao, &janela);
+  BufferAgentes buffer_recepcao;
+  buffer_iniciar(&buffer_recepcao, 64);
+
+  // Contagens por thread e por destino usadas na compactação paralela, e a
+  // posição de escrita de cada (thread, destino) após a soma de prefixos
+  int *contagem_destino = (int *)malloc(n_threads * N_DESTINOS * sizeof(int));
+
+  // Energia somada por cada thread no kernel de energia, combinada em ordem
+  // fixa para que o total não dependa do escalonamento
+  double *energia_thread = (double *)malloc(n_threads * sizeof(double));
+
+  // Limites dos trechos de custo parecido (escalonamento "custo"), o número
+  // de trechos e o custo acumulado até o trecho de agentes de cada thread
+  int *corte_custo =
+      (int *)malloc((TRECHOS_POR_THREAD * n_threads + 1) * sizeof(int));
+  int n_trechos_custo = 0;
+  double *parcial_custo = (double *)malloc((n_threads + 1) * sizeof(double));
+
+  // Métricas do ciclo, acumuladas nos passos que já percorrem os dados, e a
+  // redução não bloqueante que as leva ao rank 0
+  Metricas metricas;
+  ReducaoMetricas reducao;
+  metricas_iniciar(&reducao);
+
+  Paredes paredes = montar_paredes(&dom);
+
+  // Balanceamento dinâmico: mede o tempo de cálculo de cada processo e, a
+  // cada cfg.rebalancear_cada ciclos, pode mover os limites dos blocos
+  Balanceamento bal;
+  balanceamento_iniciar(&bal, &dom, cfg.rebalancear_cada, cfg.fator_carga);
+
+  // Direção MPI de cada código de destino (DESTINO_LOCAL/BORDA/MORTO não
+  // migram)
+  Direcao direcao_destino[N_DESTINOS];
+  for (int c = 0; c < N_DESTINOS; c++) {
+    direcao_destino[c] =
+        (c == DESTINO_LOCAL || c == DESTINO_BORDA || c == DESTINO_MORTO)
+            ? N_DIRECOES
+            : direcao_de(c % 3 - 1, c / 3 - 1);
+  }
+  long long nascimentos = 0, mortes = 0; // Neste processo, na execução toda
+
+  long long atualizacoes_agentes = 0; // Agentes processados (soma dos ciclos)
+  double tempo_calculo = 0.0; // Passos 5.3 e 5.5, sem a espera pelo halo
+
+  // Renderizador do terminal (quadros montados no rank 0)
+  Visualizacao vis;
+  visualizacao_iniciar(&vis, &dom, cfg.visualizacao, cfg.visualizar_diferencas);
+
+  // Quadros binários para pós-processamento (desligado sem --snapshot)
+  Snapshot snapshot;
+  snapshot_abrir(&snapshot, cfg.snapshot, &dom, cfg.snapshot_cada,
+                 cfg.snapshot_reducao);
+
+  // Tempo de cada fase do ciclo neste processo e de cada etapa da região de
+  // agentes em cada thread
+  Instrumentacao instr;
+  instrumentacao_iniciar(&instr, n_threads);
 
   // Sincroniza todos os processos antes de iniciar o cronómetro
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   double tempo_inicio = 0.0;
+  double tempo_visualizacao = 0.0; // Tempo gasto desenhando e pausando
   if (rank == 0) {
     tempo_inicio = MPI_Wtime();
   }
 
   // ==========================================================================================================
-  // INÍCIO DO LOOP DA SIMULAÇÃO (t = 0 até T_TOTAL)
+  // INÍCIO DO LOOP DA SIMULAÇÃO (t = 0, ou o ciclo do checkpoint, até cfg.ciclos)
   // ==========================================================================================================
-  for (int t = 0; t < T_TOTAL; t++) {
+  // Uma única região paralela para a simulação inteira: todas as threads
+  // percorrem juntas o laço de ciclos, sem abrir e fechar regiões a cada
+  // passo. Tudo o que chama MPI fica com a thread mestre (FUNNELED), que
+  // também cria as tarefas de cálculo; as demais executam as tarefas nas
+  // barreiras enquanto a mestre se comunica. O que a mestre escreve e as
+  // outras leem (contagens, ponteiros das populações) é declarado antes da
+  // região e publicado por uma barreira.
+  int n_local = 0, n_interior = 0, n_faixas = 0;
+  int total_direcao[N_DIRECOES];
+  MPI_Request req_halo[2 * N_DIRECOES];
+  double inicio_calculo = 0.0, espera_halo = 0.0, inicio_vis = 0.0;
+
+  // Recurso e tempo de cada faixa de linhas regenerada numa tarefa (5.5),
+  // somados pela mestre em ordem fixa
+  double *recurso_faixa = (double *)malloc(H_global * sizeof(double));
+  double *tempo_faixa = (double *)malloc(H_global * sizeof(double));
+
+  // Demanda das células contada por thread dona (com a lista das células
+  // visitadas, que a regeneração adiada percorre) e o tempo somado das
+  // tarefas da regeneração adiada
+  ContagemDemanda contagem_demanda;
+  populacao_contagem_iniciar(&contagem_demanda, n_threads);
+  double tempo_grid_adiado = 0.0;
+  int recontar_grid = 0; // Agregados a refazer depois do rebalanceamento
+
+#pragma omp parallel num_threads(n_threads)
+  for (int t = ciclo_inicial; t < cfg.ciclos; t++) {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+
+#pragma omp master
+    {
+      instrumentacao_marcar(&instr);
 
-    // --- 5.1) Atualizar Estação ---
-    if (rank == 0) {
-      if (t > 0 && t % S_SAZONAL == 0) {
-        estacao_atual = (estacao_atual == SECA) ? CHEIA : SECA;
+      // --- 5.1) Atualizar Estação ---
+      if (rank == 0) {
+        if (t > 0 && t % cfg.ciclos_estacao == 0) {
+          estacao_atual = (estacao_atual == SECA) ? CHEIA : SECA;
+        }
       }
+      MPI_Bcast(&estacao_atual, 1, MPI_INT, 0, comm);
+      instrumentacao_fase(&instr, FASE_ESTACAO);
+
+      // --- 5.2) Troca de Halo (Bordas e Cantos do Grid), não bloqueante ---
+      // As mensagens ficam em trânsito enquanto os agentes do interior são
+      // processados; os da borda, que consultam células do halo ao decidir
+      // o movimento, só são processados depois do MPI_Waitall (e da cópia
+      // das bordas dos vizinhos do mesmo nó, com a memória compartilhada).
+      // Na regeneração adiada, a borda que sai é antes trazida ao ciclo.
+      if (grid.adiada.ativa) {
+        grid_adiada_borda(&grid, &dom, t);
+      }
+      janela_iniciar_halo(&janela, &dom, grid.recurso, req_halo);
+      instrumentacao_fase(&instr, FASE_HALO);
+
+      // --- 5.3) Processar Agentes (tarefas OpenMP) ---
+      // Carga sintética e movimento (lendo o grid do início do ciclo) em
+      // tarefas de AGENTES_POR_TAREFA agentes; depois, com a equipe toda,
+      // consumo (agrupado por célula), kernel vetorizado de energia e
+      // compactação estável dos agentes por destino via soma de prefixos.
+      atualizacoes_agentes += atual->n;
+      n_local = atual->n;
+      n_interior = atual->n_interior;
+      for (int dir = 0; dir < N_DIRECOES; dir++) {
+        total_direcao[dir] = 0;
+      }
+      populacao_reservar(proxima, n_local);
+      inicio_calculo = MPI_Wtime();
     }
-    MPI_Bcast(&estacao_atual, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // --- 5.2) Troca de Halo (Bordas do Grid) ---
-    Celula halo_superior[W_global];
-    Celula halo_inferior[W_global];
-
-    int vizinho_cima = (rank == 0) ? MPI_PROC_NULL : rank - 1;
-    int vizinho_baixo = (rank == size - 1) ? MPI_PROC_NULL : rank + 1;
 
-    MPI_Sendrecv(&grid_local[0], W_local * sizeof(Celula), MPI_BYTE,
-                 vizinho_cima, 0, halo_superior, W_local * sizeof(Celula),
-                 MPI_BYTE, vizinho_cima, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    MPI_Sendrecv(&grid_local[(H_local - 1) * W_local], W_local * sizeof(Celula),
-                 MPI_BYTE, vizinho_baixo, 1, halo_inferior,
-                 W_local * sizeof(Celula), MPI_BYTE, vizinho_baixo, 0,
-                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    // --- 5.3) Processar Agentes (OpenMP) ---
-    ThreadBuffer *buffers_locais =
-        (ThreadBuffer *)malloc(omp_get_max_threads() * sizeof(ThreadBuffer));
-
-    int max_buffer = (n_agentes_locais > 0) ? n_agentes_locais : 1;
-    Agente *buffer_envio_cima = (Agente *)malloc(max_buffer * sizeof(Agente));
-    Agente *buffer_envio_baixo = (Agente *)malloc(max_buffer * sizeof(Agente));
-    int contagem_cima = 0, contagem_baixo = 0;
+    // 0. No modo "custo", a equipe toda prevê o custo dos agentes (depois
+    // da borda adiada trazida ao ciclo, com o halo já em trânsito) e corta
+    // a população em trechos de custo parecido
+    if (cfg.escalonamento == ESCALONAMENTO_CUSTO && cfg.fator_carga > 0) {
+#pragma omp barrier
+      populacao_cortar_por_custo(atual, &paredes, &grid, t, cfg.fator_carga,
+                                 TRECHOS_POR_THREAD * nt, corte_custo,
+                                 &n_trechos_custo, parcial_custo);
+    }
 
-#pragma omp parallel
+#pragma omp master
     {
-      int tid = omp_get_thread_num();
-      buffers_locais[tid].count = 0;
-
-#pragma omp for
-      for (int i = 0; i < n_agentes_locais; i++) {
-        Agente *a = &lista_agentes[i];
-        int idx = a->y * W_local + a->x;
-
-        // 1. Carga sintética proporcional ao recurso
-        executar_carga(grid_local[idx].recurso);
-
-        // --- NOVA LÓGICA DE CONSUMO E ENERGIA ---
-        a->energia -= 1.0; // Gasta energia a cada ciclo
-
-        double consumo_desejado = 2.0;
-        double recurso_atual;
-
-// Lê o recurso da célula de forma segura (várias threads podem ler ao mesmo
-// tempo)
-#pragma omp atomic read
-        recurso_atual = grid_local[idx].recurso;
-
-        double comeu = 0.0;
-        if (recurso_atual > 0.0) {
-          // Come o que quer, ou rapa o fundo do tacho se tiver menos do que
-          // deseja
-          comeu = (recurso_atual >= consumo_desejado) ? consumo_desejado
-                                                      : recurso_atual;
-
-// Desconta da célula de forma atómica (impede condição de corrida)
-#pragma omp atomic
-          grid_local[idx].recurso -= comeu;
+      // 1. Carga sintética de todos (sempre do interior do grid local, não
+      // depende do halo), com o halo ainda em trânsito. No modo "custo" ela
+      // vai em tarefas cortadas pelo custo previsto de cada agente; no modo
+      // "tarefas", junto com o movimento, em tarefas de tamanho fixo; no
+      // modo "runtime", num laço depois do movimento.
+      int carga_com_movimento =
+          (cfg.escalonamento == ESCALONAMENTO_TAREFAS);
+      if (cfg.escalonamento == ESCALONAMENTO_CUSTO && cfg.fator_carga > 0) {
+        for (int k = 0; k < n_trechos_custo; k++) {
+          int ini = corte_custo[k], fim = corte_custo[k + 1];
+#pragma omp task
+          {
+            double marca = omp_get_wtime();
+            for (int i = ini; i < fim; i++) {
+              executar_carga(atual->ganho[i], cfg.fator_carga);
+            }
+            instrumentacao_etapa(&instr, omp_get_thread_num(), ETAPA_CARGA,
+                                 marca);
+          }
         }
+      }
 
-        a->energia += comeu; // Agente recupera energia
-        // ----------------------------------------
-
-        // 2. Lógica simplificada de movimento (Random Walk com Paredes Globais)
-        int dx = (rand() % 3) - 1;
-        int dy = (rand() % 3) - 1;
-
-        int novo_x = a->x + dx;
-        int novo_y = a->y + dy;
-
-        // Bloqueia a saída pelas laterais Leste/Oeste (Eixo X)
-        if (novo_x < 0)
-          novo_x = 0;
-        if (novo_x >= W_local)
-          novo_x = W_local - 1;
-
-        // Bloqueia a saída pelos extremos Norte/Sul Globais (Eixo Y)
-        if (novo_y < 0 && vizinho_cima == MPI_PROC_NULL)
-          novo_y = 0;
-        if (novo_y >= H_local && vizinho_baixo == MPI_PROC_NULL)
-          novo_y = H_local - 1;
-
-        // Aplica a atualização de movimento de forma segura
-        a->gx += (novo_x - a->x);
-        a->gy += (novo_y - a->y);
-        a->x = novo_x;
-        a->y = novo_y;
-
-        // Verifica se o agente continua no grid local ou se vai migrar
-        if (a->y >= 0 && a->y < H_local) {
-          if (buffers_locais[tid].count < MAX_AG_THREAD) {
-            buffers_locais[tid].agentes[buffers_locais[tid].count] = *a;
-            buffers_locais[tid].count++;
+      // 2. Random Walk (kernel SIMD) dos agentes do interior, com o halo
+      // ainda em trânsito
+      for (int ini = 0; ini < n_interior; ini += AGENTES_POR_TAREFA) {
+        int fim = (ini + AGENTES_POR_TAREFA < n_interior)
+                      ? ini + AGENTES_POR_TAREFA
+                      : n_interior;
+#pragma omp task
+        {
+          double marca = omp_get_wtime();
+          if (carga_com_movimento) {
+            for (int i = ini; i < fim; i++) {
+              int idx = dominio_idx(&dom, atual->x[i], atual->y[i]);
+              executar_carga(grid_valor(&grid, idx, t), cfg.fator_carga);
+            }
+            marca = instrumentacao_etapa(&instr, omp_get_thread_num(),
+                                         ETAPA_CARGA, marca);
           }
-        } else {
-// Se saiu do limite Y, vai para outro processo MPI
-#pragma omp critical
+          populacao_mover(atual, ini, fim, cfg.semente, t, &paredes, &grid);
+          instrumentacao_etapa(&instr, omp_get_thread_num(), ETAPA_MOVIMENTO,
+                               marca);
+        }
+      }
+
+      // A carga dos agentes da borda também corre com o halo em trânsito,
+      // nos mesmos trechos do movimento deles (abaixo): a dependência em
+      // x[ini] garante que a posição lida é a de antes do movimento
+      if (carga_com_movimento) {
+        for (int ini = n_interior; ini < n_local; ini += AGENTES_POR_TAREFA) {
+          int fim = (ini + AGENTES_POR_TAREFA < n_local)
+                        ? ini + AGENTES_POR_TAREFA
+                        : n_local;
+#pragma omp task depend(out : atual->x[ini])
           {
-            if (a->y < 0 && vizinho_cima != MPI_PROC_NULL) {
-              buffer_envio_cima[contagem_cima++] = *a;
-            } else if (a->y >= H_local && vizinho_baixo != MPI_PROC_NULL) {
-              buffer_envio_baixo[contagem_baixo++] = *a;
+            double marca = omp_get_wtime();
+            for (int i = ini; i < fim; i++) {
+              int idx = dominio_idx(&dom, atual->x[i], atual->y[i]);
+              executar_carga(grid_valor(&grid, idx, t), cfg.fator_carga);
             }
+            instrumentacao_etapa(&instr, omp_get_thread_num(), ETAPA_CARGA,
+                                 marca);
           }
         }
       }
-    }
 
-    // Consolidação dos buffers locais na lista principal de agentes
-    n_agentes_locais = 0;
-    for (int i = 0; i < omp_get_max_threads(); i++) {
-      for (int j = 0; j < buffers_locais[i].count; j++) {
-        lista_agentes[n_agentes_locais++] = buffers_locais[i].agentes[j];
+      // A comunicação fica com a mestre; as outras threads seguem nas
+      // tarefas acima
+      double inicio_espera = MPI_Wtime();
+      janela_concluir_halo(&janela, &dom, &grid, req_halo);
+      if (grid.adiada.ativa) {
+        grid_adiada_halo(&grid, &dom, t);
+      }
+      espera_halo = MPI_Wtime() - inicio_espera;
+      instr.etapa[tid * PASSO_ETAPAS + ETAPA_ESPERA_HALO] += espera_halo;
+
+      // Agentes da borda, agora com o halo disponível (e depois da carga
+      // do mesmo trecho, no modo "tarefas")
+      for (int ini = n_interior; ini < n_local; ini += AGENTES_POR_TAREFA) {
+        int fim = (ini + AGENTES_POR_TAREFA < n_local)
+                      ? ini + AGENTES_POR_TAREFA
+                      : n_local;
+#pragma omp task depend(in : atual->x[ini])
+        {
+          double marca = omp_get_wtime();
+          populacao_mover(atual, ini, fim, cfg.semente, t, &paredes, &grid);
+          instrumentacao_etapa(&instr, omp_get_thread_num(), ETAPA_MOVIMENTO,
+                               marca);
+        }
       }
     }
-    free(buffers_locais);
-
-    // --- 5.4) Migração de Agentes (MPI) ---
-    int num_recv_cima = 0, num_recv_baixo = 0;
-
-    // Troca de tamanhos
-    MPI_Sendrecv(&contagem_cima, 1, MPI_INT, vizinho_cima, 2, &num_recv_cima, 1,
-                 MPI_INT, vizinho_cima, 3, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    MPI_Sendrecv(&contagem_baixo, 1, MPI_INT, vizinho_baixo, 3, &num_recv_baixo,
-                 1, MPI_INT, vizinho_baixo, 2, MPI_COMM_WORLD,
-                 MPI_STATUS_IGNORE);
-
-    // Troca de dados reais (Requer o mpi_agente_type criado anteriormente)
-    Agente *recv_cima =
-        malloc((num_recv_cima > 0 ? num_recv_cima : 1) * sizeof(Agente));
-    Agente *recv_baixo =
-        malloc((num_recv_baixo > 0 ? num_recv_baixo : 1) * sizeof(Agente));
-
-    MPI_Sendrecv(buffer_envio_cima, contagem_cima, mpi_agente_type,
-                 vizinho_cima, 4, recv_cima, num_recv_cima, mpi_agente_type,
-                 vizinho_cima, 5, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    MPI_Sendrecv(buffer_envio_baixo, contagem_baixo, mpi_agente_type,
-                 vizinho_baixo, 5, recv_baixo, num_recv_baixo, mpi_agente_type,
-                 vizinho_baixo, 4, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    int novo_total = n_agentes_locais + num_recv_cima + num_recv_baixo;
-    if (novo_total > capacidade_agentes) {
-      capacidade_agentes = novo_total + 1000; // Cresce com folga
-      lista_agentes =
-          (Agente *)realloc(lista_agentes, capacidade_agentes * sizeof(Agente));
-      if (lista_agentes == NULL) {
-        printf("[Rank %d] Erro fatal de memoria no realloc!\n", rank);
-        MPI_Abort(MPI_COMM_WORLD, 1);
+    // Todas as tarefas de carga e movimento terminam nesta barreira
+#pragma omp barrier
+    double marca = omp_get_wtime();
+    int ini, fim;
+
+    // Carga no modo "runtime": laço compartilhado com o escalonamento de
+    // OMP_SCHEDULE (static, dynamic, guided...). A célula de origem é a de
+    // antes do movimento, e o grid ainda não mudou.
+    if (cfg.escalonamento == ESCALONAMENTO_RUNTIME) {
+#pragma omp for schedule(runtime)
+      for (int i = 0; i < n_local; i++) {
+        executar_carga(grid_valor(&grid, atual->origem[i], t),
+                       cfg.fator_carga);
       }
+      marca = instrumentacao_etapa(&instr, tid, ETAPA_CARGA, marca);
     }
 
-    // Adicionar agentes recebidos à lista local e ajustar Y local
-    for (int i = 0; i < num_recv_cima; i++) {
-      recv_cima[i].y = H_local - 1;
-      lista_agentes[n_agentes_locais++] = recv_cima[i];
+    // 3. Consumo na célula de origem. Só começa depois que todos decidiram
+    // o movimento, para que as decisões vejam o mesmo estado do grid.
+    // Os agentes são contados por célula, sem atômicos: cada célula tem
+    // uma thread dona, que soma os agentes agrupados para ela (e anota as
+    // visitadas para a regeneração adiada). Depois cada um lê a sua parte
+    // do recurso (só leituras), dividida igualmente entre os agentes da
+    // célula, e a célula é debitada uma vez só na regeneração (5.5), pela
+    // tarefa que a percorre. O resultado não depende da ordem dos agentes
+    // nem do escalonamento.
+    populacao_contar_demanda(atual, n_local, &grid, &contagem_demanda);
+
+#pragma omp for
+    for (int i = 0; i < n_local; i++) {
+      // Aplicado à energia no kernel abaixo
+      atual->ganho[i] = grid_parte(&grid, atual->origem[i], t);
     }
-    for (int i = 0; i < num_recv_baixo; i++) {
-      recv_baixo[i].y = 0;
-      lista_agentes[n_agentes_locais++] = recv_baixo[i];
+    marca = instrumentacao_etapa(&instr, tid, ETAPA_CONSUMO, marca);
+
+    // 4. Kernel SIMD de gasto/ganho de energia no trecho desta thread,
+    // que também marca mortes e reproduções e soma a energia para as
+    // métricas
+    populacao_faixa(n_local, nt, tid, &ini, &fim);
+    energia_thread[tid] = populacao_atualizar_energia(atual, ini, fim,
+                                                      cfg.energia_reproducao);
+    marca = instrumentacao_etapa(&instr, tid, ETAPA_ENERGIA, marca);
+
+    // 5. Compactação: conta quantos agentes do trecho vão para cada destino,
+    // com o filho de quem se reproduz logo depois do pai (mesma posição,
+    // mesmo destino). Os mortos só são contados.
+    int *minha_contagem = &contagem_destino[tid * N_DESTINOS];
+    for (int c = 0; c < N_DESTINOS; c++) {
+      minha_contagem[c] = 0;
+    }
+    for (int i = ini; i < fim; i++) {
+      minha_contagem[atual->destino[i]] += 1 + atual->filhos[i];
     }
 
-    // Liberar a memória dinâmica criada neste ciclo estritamente uma vez
-    free(recv_cima);
-    free(recv_baixo);
-    free(buffer_envio_cima);
-    free(buffer_envio_baixo);
-
-// --- 5.5) Atualizar Grid Local (OpenMP) ---
-#pragma omp parallel for collapse(2)
-    for (int j = 0; j < H_local; j++) {
-      for (int i = 0; i < W_local; i++) {
-        int idx = j * W_local + i;
-        double taxa = (estacao_atual == SECA) ? 1.5 : 3.0;
-
-        // --- LIMITADOR DE CRESCIMENTO ---
-        // Áreas interditadas e aldeias não regeneram recursos
-        if (grid_local[idx].tipo != INTERDITA &&
-            grid_local[idx].tipo != ALDEIA) {
-          grid_local[idx].recurso += taxa;
-
-          // Pega o teto de produção definido para aquele tipo de terreno
-          double teto = f_recurso(grid_local[idx].tipo);
-          if (grid_local[idx].recurso > teto) {
-            grid_local[idx].recurso = teto;
-          }
+#pragma omp barrier
+#pragma omp master
+    {
+      // Soma de prefixos entre threads: cada contagem vira a posição de
+      // escrita da thread naquele destino. Os agentes que ficam no bloco
+      // são escritos em [interior | borda]. Fica com a mestre porque a
+      // fila de envio compartilhada é reservada com uma coletiva no nó.
+      metricas.energia = 0.0;
+      for (int k = 0; k < nt; k++) {
+        metricas.energia += energia_thread[k];
+      }
+
+      int total_interior = 0, mortos = 0, ficam = 0;
+      for (int k = 0; k < nt; k++) {
+        total_interior += contagem_destino[k * N_DESTINOS + DESTINO_LOCAL];
+        mortos += contagem_destino[k * N_DESTINOS + DESTINO_MORTO];
+      }
+      for (int c = 0; c < N_DESTINOS; c++) {
+        if (c == DESTINO_MORTO)
+          continue;
+        int total = (c == DESTINO_BORDA) ? total_interior : 0;
+        for (int k = 0; k < nt; k++) {
+          int cont = contagem_destino[k * N_DESTINOS + c];
+          contagem_destino[k * N_DESTINOS + c] = total;
+          total += cont;
+        }
+        if (c == DESTINO_LOCAL) {
+          proxima->n_interior = total;
+        } else if (c == DESTINO_BORDA) {
+          ficam = total;
+        } else {
+          total_direcao[direcao_destino[c]] = total;
+        }
+      }
+      int vivos = ficam;
+      for (int dir = 0; dir < N_DIRECOES; dir++) {
+        vivos += total_direcao[dir];
+      }
+      mortes += mortos;
+      nascimentos += vivos - (n_local - mortos);
+      metricas.agentes = vivos; // A migração não muda o total global
+
+      // Só cresce (dobrando) se os nascimentos passarem da capacidade; as
+      // vagas dos mortos são reaproveitadas na mesma passada. O conteúdo
+      // de proxima é descartável, então nada é copiado.
+      proxima->n = 0;
+      populacao_reservar(proxima, ficam);
+      proxima->n = ficam;
+
+      // Os que migram vão para um único buffer, agrupados por direção
+      migracao_preparar_envio(&mig, total_direcao);
+      for (int c = 0; c < N_DESTINOS; c++) {
+        if (c == DESTINO_LOCAL || c == DESTINO_BORDA || c == DESTINO_MORTO)
+          continue;
+        for (int k = 0; k < nt; k++) {
+          contagem_destino[k * N_DESTINOS + c] +=
+              mig.desloc_envio[direcao_destino[c]];
+        }
+      }
+    }
+#pragma omp barrier
+
+    // Agentes que ficam vão para a próxima população (SoA); os que saem do
+    // bloco são empacotados (AoS) no trecho da direção do vizinho
+    for (int i = ini; i < fim; i++) {
+      int c = atual->destino[i];
+      if (c == DESTINO_MORTO) {
+        continue;
+      }
+      int pos = minha_contagem[c]++;
+      if (c == DESTINO_LOCAL || c == DESTINO_BORDA) {
+        populacao_copiar(proxima, pos, atual, i);
+      } else {
+        populacao_empacotar(atual, i, &mig.envio.dados[pos]);
+      }
+      if (atual->filhos[i]) {
+        // O filho nasce na posição do pai, com a outra metade da energia
+        uint64_t id = populacao_id_filho(cfg.semente, atual->id[i], t);
+        pos = minha_contagem[c]++;
+        if (c == DESTINO_LOCAL || c == DESTINO_BORDA) {
+          populacao_copiar(proxima, pos, atual, i);
+          proxima->id[pos] = id;
+        } else {
+          populacao_empacotar(atual, i, &mig.envio.dados[pos]);
+          mig.envio.dados[pos].id = id;
         }
-        // --------------------------------
       }
     }
+    instrumentacao_etapa(&instr, tid, ETAPA_COMPACTACAO, marca);
+#pragma omp barrier
+
+#pragma omp master
+    {
+      Populacao *troca = atual;
+      atual = proxima;
+      proxima = troca;
+      double calculo_ciclo = MPI_Wtime() - inicio_calculo - espera_halo;
+      instrumentacao_fase(&instr, FASE_AGENTES);
+      instrumentacao_transferir(&instr, FASE_AGENTES, FASE_HALO, espera_halo);
+
+      // --- 5.5) Atualizar Grid Local (tarefas OpenMP) ---
+      // Criada antes da migração para correr junto com ela: a regeneração
+      // só depende da demanda do ciclo, não de onde os agentes estão. Cada
+      // faixa de linhas do interior é debitada do consumo do ciclo e
+      // regenerada pelo kernel SIMD de grid.c, que usa as tabelas de
+      // taxa/teto por tipo em vez de chamar f_recurso() e devolve o recurso
+      // já regenerado para as métricas. Na regeneração adiada, as tarefas
+      // percorrem só as células anotadas no consumo, em pedaços de até
+      // CELULAS_POR_TAREFA, e o total sai dos agregados do grid.
+      if (grid.adiada.ativa) {
+        tempo_grid_adiado = 0.0;
+        for (int k = 0; k < nt; k++) {
+          int n_visitadas = contagem_demanda.n_visitadas[k];
+          for (int m = 0; m < n_visitadas; m += CELULAS_POR_TAREFA) {
+            const int *celulas =
+                &contagem_demanda.celula[contagem_demanda.inicio[k] + m];
+            int n = (n_visitadas - m < CELULAS_POR_TAREFA)
+                        ? n_visitadas - m
+                        : CELULAS_POR_TAREFA;
+#pragma omp task
+            {
+              double inicio = omp_get_wtime();
+              grid_regenerar_celulas(&grid, estacao_atual, celulas, n, t);
+              double gasto = omp_get_wtime() - inicio;
+#pragma omp atomic update
+              tempo_grid_adiado += gasto;
+            }
+          }
+        }
+      } else {
+        int linhas = CELULAS_POR_TAREFA / W_local > 0
+                         ? CELULAS_POR_TAREFA / W_local
+                         : 1;
+        n_faixas = (H_local + linhas - 1) / linhas;
+        for (int k = 0; k < n_faixas; k++) {
+          int j0 = k * linhas;
+          int j1 = (j0 + linhas < H_local) ? j0 + linhas : H_local;
+#pragma omp task
+          {
+            double inicio = omp_get_wtime();
+            double soma = 0.0;
+            for (int j = j0; j < j1; j++) {
+              int inicio_linha = dominio_idx(&dom, 0, j);
+              soma += grid_regenerar(&grid, estacao_atual, inicio_linha,
+                                     inicio_linha + W_local);
+            }
+            recurso_faixa[k] = soma;
+            tempo_faixa[k] = omp_get_wtime() - inicio;
+          }
+        }
+      }
 
-    // --- 5.6) Métricas globais (MPI) ---
-    int total_agentes_local = n_agentes_locais;
-    double energia_total_local = 0.0;
-    double recurso_total_local = 0.0;
+      // --- 5.4) Migração de Agentes (MPI) ---
+      // Feita pela mestre enquanto as outras threads regeneram o grid. Os
+      // recém-chegados acabaram de cruzar a fronteira, então entram no
+      // trecho da borda (fim da lista)
+      buffer_recepcao.n = 0;
+      migrar_agentes(&mig, &dom, mpi_agente_type, &buffer_recepcao);
+      populacao_desempacotar(atual, &buffer_recepcao, offsetX, offsetY);
+      populacao_reservar(proxima, atual->n);
+      instrumentacao_fase(&instr, FASE_MIGRACAO);
+
+      // A mestre ajuda com as faixas que sobraram; a soma em ordem fixa não
+      // depende de qual thread regenerou cada faixa
+#pragma omp taskwait
+      double recurso_local = 0.0, tempo_grid = 0.0;
+      if (grid.adiada.ativa) {
+        recurso_local = grid_adiada_avancar(&grid, t + 1);
+        tempo_grid = tempo_grid_adiado;
+      } else {
+        for (int k = 0; k < n_faixas; k++) {
+          recurso_local += recurso_faixa[k];
+          tempo_grid += tempo_faixa[k];
+        }
+      }
+      metricas.recurso = recurso_local;
+      calculo_ciclo += tempo_grid / nt; // Tempo de cálculo por thread
+      tempo_calculo += calculo_ciclo;
+      bal.tempo_calculo += calculo_ciclo;
 
-#pragma omp parallel for reduction(+ : energia_total_local)
-    for (int i = 0; i < n_agentes_locais; i++) {
-      energia_total_local += lista_agentes[i].energia;
     }
 
-#pragma omp parallel for collapse(2) reduction(+ : recurso_total_local)
-    for (int j = 0; j < H_local; j++) {
-      for (int i = 0; i < W_local; i++) {
-        int idx = j * W_local + i;
-        recurso_total_local += grid_local[idx].recurso;
-      }
+    // Na regeneração adiada, o plano inteiro só é escrito nos ciclos em que
+    // alguém vai lê-lo: rebalanceamento (5.7), visualização (5.8),
+    // checkpoint (5.9) e snapshot (5.10). A equipe toda divide as linhas,
+    // depois da barreira que publica os agregados levados ao ciclo.
+    if (grid.adiada.ativa &&
+        ((balanceamento_na_vez(&bal, t) && t + 1 < cfg.ciclos) ||
+         (cfg.visualizar_cada > 0 && t % cfg.visualizar_cada == 0) ||
+         (cfg.checkpoint_cada > 0 && (t + 1) % cfg.checkpoint_cada == 0) ||
+         snapshot_na_vez(&snapshot, t))) {
+#pragma omp barrier
+      grid_adiada_materializar(&grid, &dom);
     }
 
-    int total_agentes_global = 0;
-    double energia_total_global = 0.0;
-    double recurso_total_global = 0.0;
-
-    MPI_Allreduce(&total_agentes_local, &total_agentes_global, 1, MPI_INT,
-                  MPI_SUM, MPI_COMM_WORLD);
-    MPI_Allreduce(&energia_total_local, &energia_total_global, 1, MPI_DOUBLE,
-                  MPI_SUM, MPI_COMM_WORLD);
-    MPI_Allreduce(&recurso_total_local, &recurso_total_global, 1, MPI_DOUBLE,
-                  MPI_SUM, MPI_COMM_WORLD);
-
-    // Impressão das Estatísticas no Terminal (A cada 10 ciclos)
-    if (rank == 0 && t % 10 == 0) {
-      printf("\n=== ESTATÍSTICAS GLOBAIS - CICLO %d ===\n", t);
-      printf("Estação atual: %s\n", (estacao_atual == SECA ? "SECA" : "CHEIA"));
-      printf("População Total (Agentes): %d\n", total_agentes_global);
-      printf("Energia Acumulada: %.2f\n", energia_total_global);
-      printf("Recursos Globais do Território: %.2f\n", recurso_total_global);
-      printf("=======================================\n");
+#pragma omp master
+    {
+      instrumentacao_fase(&instr, FASE_GRID);
+
+      // --- 5.6) Métricas globais (MPI) ---
+      // Os totais locais já saíram do kernel de energia e da regeneração. A
+      // cada amostra, conclui a redução da amostra anterior (que correu em
+      // paralelo com os ciclos seguintes) e inicia a desta.
+      if (t % cfg.metricas_cada == 0) {
+        if (metricas_concluir(&reducao) && rank == 0) {
+          reportar_metricas(&reducao, cfg.metricas_cada, &log);
+        }
+        metricas_reduzir(&reducao, &metricas, t, estacao_atual, comm);
+      }
+      instrumentacao_fase(&instr, FASE_METRICAS);
+
+      // --- 5.7) Balanceamento de carga ---
+      // Ao fim de cada intervalo, repartir os limites dos blocos segundo o
+      // tempo medido; células e agentes vão para os novos donos e a
+      // geometria local (tamanho, offsets, paredes) é refeita
+      recontar_grid = 0;
+      if (balanceamento_na_vez(&bal, t) && t + 1 < cfg.ciclos) {
+        int repartiu = balancear(&bal, &dom, &grid, &atual, &proxima,
+                                 mpi_agente_type);
+        if (repartiu) {
+          W_local = dom.W_local;
+          H_local = dom.H_local;
+          offsetX = dom.offsetX;
+          offsetY = dom.offsetY;
+          paredes = montar_paredes(&dom);
+        }
+        recontar_grid = repartiu && grid.adiada.ativa;
+        if (rank == 0) {
+          printf("[Balanceamento] Ciclo %d: desbalanceamento medido %.3f, "
+                 "estimado com novos limites %.3f -> %s\n",
+                 t, bal.desbalanceamento_medido, bal.desbalanceamento_estimado,
+                 repartiu ? "repartido" : "mantido");
+        }
+      }
+      instrumentacao_fase(&instr, FASE_BALANCEAMENTO);
+    }
+    // Populações trocadas e geometria do bloco publicadas para a equipe
+#pragma omp barrier
+
+    // Depois de um rebalanceamento, a equipe refaz os agregados da
+    // regeneração adiada no bloco novo
+    if (recontar_grid) {
+      grid_adiada_recontar(&grid, &dom);
+#pragma omp master
+      instrumentacao_fase(&instr, FASE_BALANCEAMENTO);
     }
 
-    // Registo no Log (A cada ciclo)
-    if (rank == 0) {
-      registrar_log_ciclo("log.txt", t, estacao_atual, total_agentes_global,
-                          energia_total_global, recurso_total_global);
+    // --- 5.8) Visualização (Animação no Terminal) ---
+    // No modo benchmark (cfg.visualizar_cada == 0) esta etapa é omitida por
+    // inteiro: nenhuma barreira, nenhuma impressão e nenhuma pausa.
+    if (cfg.visualizar_cada > 0 && t % cfg.visualizar_cada == 0) {
+#pragma omp master
+      inicio_vis = MPI_Wtime();
+
+      // 0. Índice de ocupação das posições finais do ciclo, para desenhar
+      // cada célula em O(1), construído pela equipe toda
+      ocupacao_construir(&ocupacao, &dom, atual);
+
+#pragma omp master
+      {
+        // 1. Cada processo codifica o seu bloco e o rank 0 junta tudo num só
+        // MPI_Gatherv, escrevendo o quadro inteiro de uma vez
+        visualizar(&vis, &dom, &grid, &ocupacao, t, estacao_atual);
+
+        // 2. Pausa para o olho humano conseguir ver o movimento. Só o rank
+        // 0 dorme; os demais esperam por ele na primeira coletiva do
+        // próximo ciclo
+        if (rank == 0) {
+          usleep(400000);
+        }
+
+        tempo_visualizacao += MPI_Wtime() - inicio_vis;
+      }
     }
 
-    // --- 5.7) Visualização (Animação no Terminal) ---
+#pragma omp master
+    {
+      instrumentacao_fase(&instr, FASE_VISUALIZACAO);
+
+      // --- 5.9) Checkpoint (MPI-IO) ---
+      // Estado completo ao fim do ciclo: o grid já regenerado, os agentes já
+      // nos donos e a estação deste ciclo; o reinício começa em t + 1
+      if (cfg.checkpoint_cada > 0 && (t + 1) % cfg.checkpoint_cada == 0) {
+        double gasto = checkpoint.tempo;
+        checkpoint_gravar(&checkpoint, cfg.checkpoint, &dom, &grid, atual,
+                          t + 1, estacao_atual, cfg.semente);
+        if (rank == 0) {
+          printf("[Checkpoint] Ciclo %d: %s gravado em %.4f segundos\n", t,
+                 cfg.checkpoint, checkpoint.tempo - gasto);
+        }
+      }
+      instrumentacao_fase(&instr, FASE_CHECKPOINT);
 
-    // 1. Sincroniza e limpa o terminal
-    MPI_Barrier(MPI_COMM_WORLD);
-    if (rank == 0) {
-      system("clear"); // Limpa o ecrã para o próximo "frame"
+      // --- 5.10) Snapshot (MPI-IO) ---
+      // Grid e agentes (amostrados) do fim do ciclo, num quadro acrescentado
+      // ao arquivo por escritas coletivas
+      if (snapshot_na_vez(&snapshot, t)) {
+        snapshot_gravar(&snapshot, &dom, &grid, atual, t, estacao_atual);
+      }
+      instrumentacao_fase(&instr, FASE_SNAPSHOT);
     }
 
-    // 2. Cada processo imprime a sua fatia de ecrã, UM POR VEZ (Fila Indiana)
-    for (int p = 0; p < size; p++) {
-      MPI_Barrier(MPI_COMM_WORLD); // Sincroniza todos antes da vez do próximo
-      if (rank == p) {
-        visualizar_subgrid(rank, W_local, H_local, offsetY, grid_local,
-                           lista_agentes, n_agentes_locais);
+    // --- 5.11) Reordenação dos agentes (curva de Morton) ---
+    // A cada cfg.reordenar_cada ciclos a equipe toda ordena a população
+    // (já lida pelos quadros de 5.9 e 5.10) pela posição, para que os
+    // acessos ao grid nos próximos ciclos sigam a memória
+    if (cfg.reordenar_cada > 0 && (t + 1) % cfg.reordenar_cada == 0) {
+#pragma omp barrier
+      ordenacao_morton(&ordenacao, proxima, atual, W_local, H_local);
+#pragma omp master
+      {
+        Populacao *troca = atual;
+        atual = proxima;
+        proxima = troca;
       }
     }
+#pragma omp master
+    instrumentacao_fase(&instr, FASE_REORDENACAO);
+    // As outras threads seguem direto para a barreira do próximo ciclo
 
-    // 3. Pausa a execução para o olho humano conseguir ver o movimento
-    MPI_Barrier(MPI_COMM_WORLD); // Sincroniza antes do sleep para o ecrã não
-                                 // piscar errado
-    usleep(400000);
+  } // FIM DO LAÇO FOR (t) E DA REGIÃO PARALELA
 
-  } // FIM DO LAÇO FOR (t)
+  // A última amostra ainda está em trânsito
+  instrumentacao_marcar(&instr);
+  if (metricas_concluir(&reducao) && rank == 0) {
+    reportar_metricas(&reducao, cfg.metricas_cada, &log);
+  }
+  instrumentacao_fase(&instr, FASE_METRICAS);
 
   // ==========================================================================================================
   // FIM DA SIMULAÇÃO - MEDIÇÃO DE TEMPO E FINALIZAÇÃO
   // ==========================================================================================================
 
   // Sincroniza todos os processos no final para a medição ser justa
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
+  double tempo_fim = MPI_Wtime();
+
+  // Checksum das posições finais: soma (módulo 2^64) das assinaturas de todos
+  // os agentes. Deve ser idêntico para qualquer OMP_NUM_THREADS e número de
+  // processos com a mesma semente, servindo de teste de regressão.
+  uint64_t checksum_local = 0, checksum_global = 0;
+  for (int i = 0; i < atual->n; i++) {
+    checksum_local +=
+        assinatura_agente(atual->id[i], atual->gx[i], atual->gy[i]);
+  }
+  MPI_Reduce(&checksum_local, &checksum_global, 1, MPI_UINT64_T, MPI_SUM, 0,
+             comm);
+
+  long realocacoes_local = pool_realocacoes(), realocacoes_global = 0;
+  MPI_Reduce(&realocacoes_local, &realocacoes_global, 1, MPI_LONG, MPI_SUM, 0,
+             comm);
+  double tempo_migracao_max = 0.0;
+  MPI_Reduce(&instr.fase[FASE_MIGRACAO], &tempo_migracao_max, 1, MPI_DOUBLE, MPI_MAX, 0,
+             comm);
+  double tempo_calculo_max = 0.0, tempo_calculo_soma = 0.0;
+  MPI_Reduce(&tempo_calculo, &tempo_calculo_max, 1, MPI_DOUBLE, MPI_MAX, 0,
+             comm);
+  MPI_Reduce(&tempo_calculo, &tempo_calculo_soma, 1, MPI_DOUBLE, MPI_SUM, 0,
+             comm);
+  long long ciclo_vida[3] = {nascimentos, mortes, atual->n}, ciclo_vida_global[3];
+  MPI_Reduce(ciclo_vida, ciclo_vida_global, 3, MPI_LONG_LONG, MPI_SUM, 0,
+             comm);
+  double tempo_checkpoint_max = 0.0;
+  MPI_Reduce(&checkpoint.tempo, &tempo_checkpoint_max, 1, MPI_DOUBLE, MPI_MAX,
+             0, comm);
+  double tempo_snapshot_max = 0.0;
+  MPI_Reduce(&snapshot.tempo, &tempo_snapshot_max, 1, MPI_DOUBLE, MPI_MAX, 0,
+             comm);
+  double tempo_reordenacao_max = 0.0;
+  MPI_Reduce(&ordenacao.tempo, &tempo_reordenacao_max, 1, MPI_DOUBLE,
+             MPI_MAX, 0, comm);
+  long long atualizacoes_global = 0;
+  MPI_Reduce(&atualizacoes_agentes, &atualizacoes_global, 1, MPI_LONG_LONG,
+             MPI_SUM, 0, comm);
 
   if (rank == 0) {
-    double tempo_fim = MPI_Wtime();
-    printf("\nTempo total de execucao: %.2f segundos\n",
+    printf("\nTempo total de execucao: %.4f segundos\n",
            tempo_fim - tempo_inicio);
+    printf("Tempo de simulacao (sem visualizacao): %.4f segundos\n",
+           tempo_fim - tempo_inicio - tempo_visualizacao);
+    printf("Checksum das posicoes: %016llx\n",
+           (unsigned long long)checksum_global);
+    printf("Realocacoes de buffers de agentes (todos os processos): %ld\n",
+           realocacoes_global);
+    double tempo_simulacao = tempo_fim - tempo_inicio - tempo_visualizacao;
+    printf("Tempo de migracao (%s, maximo entre processos): %.4f segundos\n",
+           migracao_nome(mig.modo), tempo_migracao_max);
+    printf("Desbalanceamento do calculo (maximo/media entre processos): "
+           "%.3f\n",
+           tempo_calculo_soma > 0.0
+               ? tempo_calculo_max / (tempo_calculo_soma / size)
+               : 1.0);
+    printf("Rebalanceamentos: %d de %d tentativas (%.4f segundos)\n",
+           bal.n_reparticoes, bal.n_tentativas, bal.tempo_balanceamento);
+    printf("Nascimentos: %lld | Mortes: %lld | Populacao final: %lld\n",
+           ciclo_vida_global[0], ciclo_vida_global[1], ciclo_vida_global[2]);
+    if (ordenacao.n_reordenacoes > 0) {
+      printf("Reordenacoes de Morton: %d, %.4f segundos (maximo entre "
+             "processos)\n",
+             ordenacao.n_reordenacoes, tempo_reordenacao_max);
+    }
+    if (checkpoint.n_gravados > 0) {
+      double mb = checkpoint.bytes / (1024.0 * 1024.0);
+      printf("Checkpoints: %d gravados, %.1f MB, %.4f segundos (%.1f MB/s, "
+             "maximo entre processos)\n",
+             checkpoint.n_gravados, mb, tempo_checkpoint_max,
+             tempo_checkpoint_max > 0.0 ? mb / tempo_checkpoint_max : 0.0);
+    }
+    if (snapshot.n_quadros > 0) {
+      printf("Snapshots: %d quadros, %.1f MB, %.4f segundos (maximo entre "
+             "processos)\n",
+             snapshot.n_quadros, snapshot.bytes / (1024.0 * 1024.0),
+             tempo_snapshot_max);
+    }
+    printf("Atualizacoes de agentes por segundo: %.3e\n",
+           tempo_simulacao > 0.0 ? atualizacoes_global / tempo_simulacao : 0.0);
   }
 
-  // Finalização básica
-  free(grid_local);
-  free(lista_agentes);
+  // Tempo por fase e por etapa de thread, agregado entre processos
+  instrumentacao_relatorio(&instr, comm, tempo_fim - tempo_inicio,
+                           cfg.relatorio);
+
+  // Finalização básica (o log grava o que restou em memória ao fechar)
+  if (rank == 0) {
+    logger_fechar(&log);
+  }
+  grid_liberar(&grid);
+  populacao_liberar(&populacoes[0]);
+  populacao_liberar(&populacoes[1]);
+  migracao_liberar(&mig);
+  janela_liberar(&janela);
+  balanceamento_liberar(&bal);
+  buffer_liberar(&buffer_recepcao);
+  free(contagem_destino);
+  free(energia_thread);
+  free(corte_custo);
+  free(parcial_custo);
+  free(recurso_faixa);
+  populacao_contagem_liberar(&contagem_demanda);
+  free(tempo_faixa);
+  ocupacao_liberar(&ocupacao);
+  ordenacao_liberar(&ordenacao);
+  instrumentacao_liberar(&instr);
+  checkpoint_liberar(&checkpoint);
+  snapshot_fechar(&snapshot);
+  visualizacao_liberar(&vis);
+  metricas_liberar(&reducao);
 
   // Limpeza final de tipos MPI criados manualmente
   MPI_Type_free(&mpi_agente_type);
+  dominio_liberar(&dom);
 
   MPI_Finalize();
   return 0;
@@ -0,0 +1,55 @@
+#include "metricas.h"
+#include <stddef.h>
+
+// Soma campo a campo; MPI_SUM não se aplica a tipos struct.
+static void somar_metricas(void *entrada, void *saida, int *n,
+                           MPI_Datatype *tipo) {
+  (void)tipo;
+  const Metricas *a = (const Metricas *)entrada;
+  Metricas *b = (Metricas *)saida;
+  for (int k = 0; k < *n; k++) {
+    b[k].energia += a[k].energia;
+    b[k].recurso += a[k].recurso;
+    b[k].agentes += a[k].agentes;
+  }
+}
+
+void metricas_iniciar(ReducaoMetricas *r) {
+  int blocos[2] = {2, 1}; // {energia, recurso}, {agentes}
+  MPI_Aint deslocamentos[2] = {offsetof(Metricas, energia),
+                               offsetof(Metricas, agentes)};
+  MPI_Datatype tipos[2] = {MPI_DOUBLE, MPI_LONG_LONG};
+  MPI_Datatype tipo;
+  MPI_Type_create_struct(2, blocos, deslocamentos, tipos, &tipo);
+  MPI_Type_create_resized(tipo, 0, sizeof(Metricas), &r->tipo);
+  MPI_Type_free(&tipo);
+  MPI_Type_commit(&r->tipo);
+  MPI_Op_create(somar_metricas, 1, &r->soma);
+
+  r->req = MPI_REQUEST_NULL;
+  r->em_transito = 0;
+  r->ciclo = -1;
+}
+
+void metricas_liberar(ReducaoMetricas *r) {
+  MPI_Op_free(&r->soma);
+  MPI_Type_free(&r->tipo);
+}
+
+void metricas_reduzir(ReducaoMetricas *r, const Metricas *local, int ciclo,
+                      Estacao estacao, MPI_Comm comm) {
+  r->local = *local;
+  r->ciclo = ciclo;
+  r->estacao = estacao;
+  r->em_transito = 1;
+  MPI_Ireduce(&r->local, &r->global, 1, r->tipo, r->soma, 0, comm, &r->req);
+}
+
+int metricas_concluir(ReducaoMetricas *r) {
+  if (!r->em_transito) {
+    return 0;
+  }
+  MPI_Wait(&r->req, MPI_STATUS_IGNORE);
+  r->em_transito = 0;
+  return 1;
+}
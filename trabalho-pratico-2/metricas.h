@@ -0,0 +1,45 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <mpi.h>
+
+#include "grid.h"
+
+// Métricas globais de um ciclo. São acumuladas localmente nos passos que já
+// percorrem os dados (kernel de energia e regeneração do grid) e somadas
+// entre processos numa única redução de um tipo struct.
+typedef struct {
+  double energia;    // Energia total dos agentes após o ciclo
+  double recurso;    // Recurso total do território após a regeneração
+  long long agentes; // População total
+} Metricas;
+
+// Redução não bloqueante das métricas para o rank 0. Os buffers ficam aqui
+// porque precisam sobreviver até a conclusão, que só acontece na próxima
+// amostra (sobrepondo a redução ao ciclo seguinte) ou no fim da simulação.
+typedef struct {
+  MPI_Datatype tipo;
+  MPI_Op soma;
+  MPI_Request req;
+  Metricas local;
+  Metricas global;
+  int em_transito;
+  int ciclo; // Ciclo a que se referem local/global
+  Estacao estacao;
+} ReducaoMetricas;
+
+// Assinaturas
+void metricas_iniciar(ReducaoMetricas *r);
+void metricas_liberar(ReducaoMetricas *r);
+
+// Inicia a redução das métricas locais do ciclo (coletiva). Só pode ser
+// chamada sem redução em trânsito.
+void metricas_reduzir(ReducaoMetricas *r, const Metricas *local, int ciclo,
+                      Estacao estacao, MPI_Comm comm);
+
+// Conclui a redução em trânsito, se houver (coletiva). Retorna 1 se alguma
+// foi concluída; no rank 0, r->global, r->ciclo e r->estacao descrevem-na
+// até a próxima chamada de metricas_reduzir.
+int metricas_concluir(ReducaoMetricas *r);
+
+#endif
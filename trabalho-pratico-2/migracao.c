@@ -0,0 +1,216 @@
+#include "migracao.h"
+#include <string.h>
+
+#define TAG_MIGRACAO 100
+
+static const char *nomes_modo[] = {"pares", "vizinhanca", "sonda"};
+
+int migracao_modo_de(const char *nome, ModoMigracao *modo) {
+  for (int k = 0; k < 3; k++) {
+    if (strcmp(nome, nomes_modo[k]) == 0) {
+      *modo = (ModoMigracao)k;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *migracao_nome(ModoMigracao modo) { return nomes_modo[modo]; }
+
+void migracao_iniciar(Migracao *m, const Dominio *d, ModoMigracao modo,
+                      Janela *janela) {
+  m->modo = modo;
+  m->janela = janela;
+  if (janela->ativa) {
+    // O buffer de envio passa a ser a fila da janela (migracao_preparar_envio)
+    m->envio.dados = NULL;
+    m->envio.n = 0;
+    m->envio.capacidade = 0;
+  } else {
+    buffer_iniciar(&m->envio, 64);
+  }
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    m->vizinhos[dir] = janela->vizinhos_msg[dir];
+    m->contagem_envio[dir] = 0;
+    m->desloc_envio[dir] = 0;
+  }
+
+  // Vizinhos que recebem mensagens, na ordem das direções. Numa topologia
+  // cartesiana não periódica cada direção leva a um rank diferente, então a
+  // mesma lista serve de origens e destinos do grafo.
+  int vizinhos[N_DIRECOES], pesos[N_DIRECOES];
+  m->n_vizinhos = 0;
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    if (m->vizinhos[dir] != MPI_PROC_NULL) {
+      m->direcao_vizinho[m->n_vizinhos] = dir;
+      pesos[m->n_vizinhos] = 1;
+      vizinhos[m->n_vizinhos++] = m->vizinhos[dir];
+    }
+  }
+
+  m->comm_vizinhos = MPI_COMM_NULL;
+  if (modo == MIGRACAO_VIZINHANCA) {
+    MPI_Dist_graph_create_adjacent(d->comm, m->n_vizinhos, vizinhos, pesos,
+                                   m->n_vizinhos, vizinhos, pesos,
+                                   MPI_INFO_NULL, 0, &m->comm_vizinhos);
+  }
+}
+
+void migracao_liberar(Migracao *m) {
+  if (!m->janela->ativa) {
+    buffer_liberar(&m->envio); // A fila da janela é liberada com ela
+  }
+  if (m->comm_vizinhos != MPI_COMM_NULL) {
+    MPI_Comm_free(&m->comm_vizinhos);
+  }
+}
+
+// Define quantos agentes sairão por direção e reserva o buffer de envio.
+void migracao_preparar_envio(Migracao *m, const int contagem[N_DIRECOES]) {
+  int total = 0;
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    m->contagem_envio[dir] = contagem[dir];
+    m->desloc_envio[dir] = total;
+    total += contagem[dir];
+  }
+  if (m->janela->ativa) {
+    m->envio.dados = janela_reservar_fila(m->janela, total);
+    m->envio.capacidade = m->janela->capacidade_fila;
+    janela_publicar_contagens(m->janela, m->contagem_envio, m->desloc_envio);
+  } else {
+    buffer_reservar(&m->envio, total);
+  }
+  m->envio.n = total;
+}
+
+// Duas rodadas por direção: contagens e depois dados (o esquema original).
+static int migrar_pares(Migracao *m, const Dominio *d,
+                        MPI_Datatype tipo_agente, BufferAgentes *recebidos) {
+  const int *vizinhos = m->vizinhos;
+  int num_recv[N_DIRECOES];
+
+  // Troca de tamanhos: o que sai pela direção dir chega do lado oposto
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    Direcao op = direcao_oposta(dir);
+    num_recv[op] = 0;
+    MPI_Sendrecv(&m->contagem_envio[dir], 1, MPI_INT, vizinhos[dir], dir,
+                 &num_recv[op], 1, MPI_INT, vizinhos[op], dir, d->comm,
+                 MPI_STATUS_IGNORE);
+  }
+
+  int total_recv = 0;
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    total_recv += num_recv[dir];
+  }
+
+  buffer_reservar(recebidos, recebidos->n + total_recv);
+
+  // Troca de dados reais, recebendo direto no fim do buffer
+  Agente *destino = recebidos->dados + recebidos->n;
+  for (int dir = 0; dir < N_DIRECOES; dir++) {
+    Direcao op = direcao_oposta(dir);
+    int desloc = 0;
+    for (int k = 0; k < (int)op; k++) {
+      desloc += num_recv[k];
+    }
+    MPI_Sendrecv(m->envio.dados + m->desloc_envio[dir], m->contagem_envio[dir],
+                 tipo_agente, vizinhos[dir], N_DIRECOES + dir,
+                 destino + desloc, num_recv[op], tipo_agente, vizinhos[op],
+                 N_DIRECOES + dir, d->comm, MPI_STATUS_IGNORE);
+  }
+
+  recebidos->n += total_recv;
+  return total_recv;
+}
+
+// Coletivas de vizinhança no grafo distribuído: uma troca de contagens com
+// todos os vizinhos de uma vez e uma de dados, independente de quantos
+// vizinhos existam.
+static int migrar_vizinhanca(Migracao *m, MPI_Datatype tipo_agente,
+                             BufferAgentes *recebidos) {
+  int n = m->n_vizinhos;
+  int cont_envio[N_DIRECOES] = {0}, desl_envio[N_DIRECOES] = {0};
+  int cont_recv[N_DIRECOES] = {0}, desl_recv[N_DIRECOES] = {0};
+
+  for (int k = 0; k < n; k++) {
+    int dir = m->direcao_vizinho[k];
+    cont_envio[k] = m->contagem_envio[dir];
+    desl_envio[k] = m->desloc_envio[dir];
+  }
+  MPI_Neighbor_alltoall(cont_envio, 1, MPI_INT, cont_recv, 1, MPI_INT,
+                        m->comm_vizinhos);
+
+  int total_recv = 0;
+  for (int k = 0; k < n; k++) {
+    desl_recv[k] = total_recv;
+    total_recv += cont_recv[k];
+  }
+  buffer_reservar(recebidos, recebidos->n + total_recv);
+
+  MPI_Neighbor_alltoallv(m->envio.dados, cont_envio, desl_envio, tipo_agente,
+                         recebidos->dados + recebidos->n, cont_recv, desl_recv,
+                         tipo_agente, m->comm_vizinhos);
+
+  recebidos->n += total_recv;
+  return total_recv;
+}
+
+// Uma só fase: cada vizinho recebe uma mensagem (possivelmente vazia) e o
+// tamanho é descoberto com MPI_Mprobe, sem troca prévia de contagens. Os
+// vizinhos são sondados em ordem fixa de direção para que a ordem dos
+// agentes recebidos seja reprodutível.
+static int migrar_sonda(Migracao *m, const Dominio *d,
+                        MPI_Datatype tipo_agente, BufferAgentes *recebidos) {
+  MPI_Request req[N_DIRECOES];
+  int n = m->n_vizinhos;
+
+  for (int k = 0; k < n; k++) {
+    int dir = m->direcao_vizinho[k];
+    MPI_Isend(m->envio.dados + m->desloc_envio[dir], m->contagem_envio[dir],
+              tipo_agente, m->vizinhos[dir], TAG_MIGRACAO, d->comm, &req[k]);
+  }
+
+  int total_recv = 0;
+  for (int k = 0; k < n; k++) {
+    int dir = m->direcao_vizinho[k];
+    MPI_Message msg;
+    MPI_Status status;
+    int cont;
+    MPI_Mprobe(m->vizinhos[dir], TAG_MIGRACAO, d->comm, &msg, &status);
+    MPI_Get_count(&status, tipo_agente, &cont);
+    buffer_reservar(recebidos, recebidos->n + cont);
+    MPI_Mrecv(recebidos->dados + recebidos->n, cont, tipo_agente, &msg,
+              MPI_STATUS_IGNORE);
+    recebidos->n += cont;
+    total_recv += cont;
+  }
+
+  MPI_Waitall(n, req, MPI_STATUSES_IGNORE);
+  return total_recv;
+}
+
+int migrar_agentes(Migracao *m, const Dominio *d, MPI_Datatype tipo_agente,
+                   BufferAgentes *recebidos) {
+  // Primeiro os vizinhos do mesmo nó, lidos direto das filas deles
+  int total = 0;
+  if (m->janela->ativa) {
+    total += janela_receber_agentes(m->janela, recebidos);
+  }
+
+  switch (m->modo) {
+  case MIGRACAO_VIZINHANCA:
+    total += migrar_vizinhanca(m, tipo_agente, recebidos);
+    break;
+  case MIGRACAO_SONDA:
+    total += migrar_sonda(m, d, tipo_agente, recebidos);
+    break;
+  default:
+    total += migrar_pares(m, d, tipo_agente, recebidos);
+    break;
+  }
+
+  if (m->janela->ativa) {
+    janela_liberar_filas(m->janela);
+  }
+  return total;
+}
@@ -0,0 +1,53 @@
+#ifndef MIGRACAO_H
+#define MIGRACAO_H
+
+#include "agente.h"
+#include "dominio.h"
+#include "janela.h"
+#include "pool.h"
+
+// Estratégias de troca de agentes entre blocos vizinhos
+typedef enum {
+  MIGRACAO_PARES,      // 8 MPI_Sendrecv de contagens + 8 de dados
+  MIGRACAO_VIZINHANCA, // MPI_Neighbor_alltoall + MPI_Neighbor_alltoallv
+  MIGRACAO_SONDA,      // MPI_Isend + MPI_Mprobe/MPI_Mrecv (uma só fase)
+} ModoMigracao;
+
+// Estado persistente da migração. Os agentes que saem ficam num único buffer
+// AoS, agrupados por direção: os da direção dir ocupam
+// [desloc_envio[dir], desloc_envio[dir] + contagem_envio[dir]).
+//
+// Com a memória compartilhada ativa, o buffer de envio é a fila da janela:
+// os vizinhos do mesmo nó leem dela, e só os de outros nós entram na troca
+// de mensagens do modo escolhido (vizinhos, com MPI_PROC_NULL nas direções
+// do mesmo nó).
+typedef struct {
+  ModoMigracao modo;
+  Janela *janela;
+  int vizinhos[N_DIRECOES];
+  BufferAgentes envio;
+  int contagem_envio[N_DIRECOES];
+  int desloc_envio[N_DIRECOES];
+
+  // Grafo distribuído só com os vizinhos de mensagens (modo VIZINHANCA)
+  MPI_Comm comm_vizinhos;
+  int n_vizinhos;
+  int direcao_vizinho[N_DIRECOES]; // Direção de cada vizinho do grafo
+} Migracao;
+
+// Assinaturas
+int migracao_modo_de(const char *nome, ModoMigracao *modo);
+const char *migracao_nome(ModoMigracao modo);
+void migracao_iniciar(Migracao *m, const Dominio *d, ModoMigracao modo,
+                      Janela *janela);
+void migracao_liberar(Migracao *m);
+void migracao_preparar_envio(Migracao *m, const int contagem[N_DIRECOES]);
+
+// Envia os agentes de m->envio aos vizinhos e acrescenta os recebidos ao fim
+// de recebidos (crescendo o buffer se preciso), em ordem fixa de direção.
+// As posições locais são recalculadas por quem desempacota. Retorna o número
+// de agentes recebidos.
+int migrar_agentes(Migracao *m, const Dominio *d, MPI_Datatype tipo_agente,
+                   BufferAgentes *recebidos);
+
+#endif
@@ -0,0 +1,81 @@
+#include "numa.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Marca de que os padrões já foram aplicados (evita reexecutar de novo)
+#define MARCA_AFINIDADE "SIMULACAO_AFINIDADE_APLICADA"
+
+static const char *nomes_afinidade[] = {"nenhuma", "proxima", "espalhada"};
+static const char *bind_afinidade[] = {NULL, "close", "spread"};
+
+int numa_afinidade_de(const char *nome, Afinidade *afinidade) {
+  for (int k = 0; k < 3; k++) {
+    if (strcmp(nome, nomes_afinidade[k]) == 0) {
+      *afinidade = (Afinidade)k;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *numa_afinidade_nome(Afinidade afinidade) {
+  return nomes_afinidade[afinidade];
+}
+
+// Procura --afinidade na linha de comando (a configuração completa só é lida
+// depois do MPI_Init). Um valor inválido é deixado para config.c recusar.
+static Afinidade afinidade_pedida(int argc, char **argv) {
+  Afinidade afinidade = AFINIDADE_ESPALHADA;
+  for (int i = 1; i < argc; i++) {
+    const char *valor = NULL;
+    if (strcmp(argv[i], "--afinidade") == 0 && i + 1 < argc) {
+      valor = argv[i + 1];
+    } else if (strncmp(argv[i], "--afinidade=", 12) == 0) {
+      valor = argv[i] + 12;
+    }
+    if (valor != NULL) {
+      numa_afinidade_de(valor, &afinidade);
+    }
+  }
+  return afinidade;
+}
+
+void numa_aplicar_afinidade(int argc, char **argv) {
+  Afinidade afinidade = afinidade_pedida(argc, argv);
+  if (afinidade == AFINIDADE_NENHUMA || getenv(MARCA_AFINIDADE) != NULL) {
+    return;
+  }
+  int mudou = 0;
+  if (getenv("OMP_PROC_BIND") == NULL) {
+    setenv("OMP_PROC_BIND", bind_afinidade[afinidade], 1);
+    mudou = 1;
+  }
+  if (getenv("OMP_PLACES") == NULL) {
+    setenv("OMP_PLACES", "cores", 1);
+    mudou = 1;
+  }
+  if (!mudou) {
+    return;
+  }
+  setenv(MARCA_AFINIDADE, "1", 1);
+  execv("/proc/self/exe", argv);
+  // Sem /proc (ou sem permissão) segue sem fixar as threads
+  fprintf(stderr, "Aviso: nao foi possivel reexecutar para aplicar "
+                  "OMP_PROC_BIND/OMP_PLACES\n");
+}
+
+void numa_primeiro_toque(void *v, size_t bytes) {
+  char *p = (char *)v;
+#pragma omp parallel
+  {
+    size_t nt = (size_t)omp_get_num_threads();
+    size_t tid = (size_t)omp_get_thread_num();
+    size_t base = bytes / nt, resto = bytes % nt;
+    size_t ini = tid * base + (tid < resto ? tid : resto);
+    size_t tamanho = base + (tid < resto ? 1 : 0);
+    memset(p + ini, 0, tamanho);
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+// Posição da memória e das threads em nós com mais de um socket. No Linux a
+// página fica no nó NUMA da thread que a escreve primeiro ("first touch"),
+// então os vetores grandes são zerados em paralelo, cada thread no mesmo
+// trecho estático que os laços de cálculo lhe dão depois.
+typedef enum {
+  AFINIDADE_NENHUMA,   // Não mexe em OMP_PROC_BIND / OMP_PLACES
+  AFINIDADE_PROXIMA,   // close: threads de um processo em núcleos vizinhos
+  AFINIDADE_ESPALHADA, // spread: threads distribuídas pelos sockets
+} Afinidade;
+
+// Assinaturas
+int numa_afinidade_de(const char *nome, Afinidade *afinidade);
+const char *numa_afinidade_nome(Afinidade afinidade);
+
+// Chamada antes de MPI_Init. O runtime do OpenMP lê OMP_PROC_BIND e
+// OMP_PLACES ao carregar, então, se for preciso definir os padrões de
+// --afinidade, o programa se reexecuta com eles (uma vez só). Valores já
+// presentes no ambiente são respeitados.
+void numa_aplicar_afinidade(int argc, char **argv);
+
+// Zera bytes de v em paralelo, com a divisão de um schedule(static). Dentro
+// de uma região paralela ativa roda numa thread só.
+void numa_primeiro_toque(void *v, size_t bytes);
+
+#endif
@@ -0,0 +1,135 @@
+#include "ocupacao.h"
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int *realocar_ints(int *v, int n) {
+  v = (int *)realloc(v, (n > 0 ? n : 1) * sizeof(int));
+  if (v == NULL) {
+    printf("Erro fatal de memoria no indice de ocupacao (%d entradas)!\n", n);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  return v;
+}
+
+void ocupacao_iniciar(Ocupacao *o) {
+  o->n_celulas = 0;
+  o->capacidade_celulas = 0;
+  o->capacidade_agentes = 0;
+  o->inicio = o->cursor = o->agente = o->celula = NULL;
+  o->parcial = realocar_ints(NULL, omp_get_max_threads() + 1);
+}
+
+void ocupacao_liberar(Ocupacao *o) {
+  free(o->inicio);
+  free(o->cursor);
+  free(o->agente);
+  free(o->celula);
+  free(o->parcial);
+}
+
+// Cresce os vetores sob demanda; com o bloco e a população estáveis, nenhuma
+// alocação acontece entre ciclos.
+static void reservar(Ocupacao *o, int n_celulas, int n_agentes) {
+  if (n_celulas > o->capacidade_celulas) {
+    o->capacidade_celulas = n_celulas;
+    o->inicio = realocar_ints(o->inicio, n_celulas + 1);
+    o->cursor = realocar_ints(o->cursor, n_celulas);
+  }
+  if (n_agentes > o->capacidade_agentes) {
+    int nova = (o->capacidade_agentes > 0) ? o->capacidade_agentes : 1024;
+    while (nova < n_agentes) {
+      nova *= 2;
+    }
+    o->capacidade_agentes = nova;
+    o->agente = realocar_ints(o->agente, nova);
+    o->celula = realocar_ints(o->celula, nova);
+  }
+  o->n_celulas = n_celulas;
+}
+
+// Counting sort paralelo: histograma por célula (incrementos atômicos, quase
+// sem disputa), soma de prefixos em blocos por thread, distribuição com
+// captura atômica do cursor e, por fim, ordenação de cada célula (poucos
+// agentes, inserção) para que a ordem não dependa do escalonamento.
+// Órfã: as construções de divisão de trabalho se ligam à região paralela de
+// quem chama (ou rodam numa thread só, fora de uma).
+void ocupacao_construir(Ocupacao *o, const Dominio *d, const Populacao *p) {
+  int n_celulas = dominio_celulas_com_halo(d);
+  int n = p->n;
+#pragma omp single
+  reservar(o, n_celulas, n);
+  int *restrict inicio = o->inicio;
+  int *restrict cursor = o->cursor;
+  int *restrict agente = o->agente;
+  int *restrict celula = o->celula;
+  int *parcial = o->parcial;
+
+  int tid = omp_get_thread_num();
+  int nt = omp_get_num_threads();
+
+#pragma omp for
+  for (int c = 0; c < n_celulas; c++) {
+    cursor[c] = 0;
+  }
+
+  // 1. Histograma
+#pragma omp for
+  for (int i = 0; i < n; i++) {
+    int c = dominio_idx(d, p->x[i], p->y[i]);
+    celula[i] = c;
+#pragma omp atomic
+    cursor[c]++;
+  }
+
+  // 2. Soma de prefixos exclusiva: cada thread soma o seu trecho de
+  // células, uma thread acumula os totais e cada uma desloca o seu trecho
+  int ini, fim;
+  populacao_faixa(n_celulas, nt, tid, &ini, &fim);
+  int soma = 0;
+  for (int c = ini; c < fim; c++) {
+    soma += cursor[c];
+  }
+  parcial[tid + 1] = soma;
+#pragma omp barrier
+#pragma omp single
+  {
+    parcial[0] = 0;
+    for (int k = 1; k <= nt; k++) {
+      parcial[k] += parcial[k - 1];
+    }
+    inicio[n_celulas] = n;
+  }
+  int acumulado = parcial[tid];
+  for (int c = ini; c < fim; c++) {
+    int cont = cursor[c];
+    inicio[c] = acumulado;
+    cursor[c] = acumulado;
+    acumulado += cont;
+  }
+#pragma omp barrier
+
+  // 3. Distribuição
+#pragma omp for
+  for (int i = 0; i < n; i++) {
+    int pos;
+#pragma omp atomic capture
+    pos = cursor[celula[i]]++;
+    agente[pos] = i;
+  }
+
+  // 4. Ordem crescente dentro de cada célula
+#pragma omp for schedule(static, 1024)
+  for (int c = 0; c < n_celulas; c++) {
+    for (int k = inicio[c] + 1; k < inicio[c + 1]; k++) {
+      int v = agente[k];
+      int j = k - 1;
+      while (j >= inicio[c] && agente[j] > v) {
+        agente[j + 1] = agente[j];
+        j--;
+      }
+      agente[j + 1] = v;
+    }
+  }
+}
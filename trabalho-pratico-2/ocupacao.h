@@ -0,0 +1,40 @@
+#ifndef OCUPACAO_H
+#define OCUPACAO_H
+
+#include "dominio.h"
+#include "populacao.h"
+
+// Índice de ocupação do bloco local: os agentes agrupados por célula
+// (counting sort em formato CSR). Os índices (na população) dos agentes da
+// célula idx = dominio_idx(x, y) ficam em agente[inicio[idx], inicio[idx+1]),
+// em ordem crescente. Cobre o grid com halo, cujas células ficam vazias.
+//
+// É reconstruído a cada ciclo, depois da migração, e vale enquanto a
+// população não for reordenada (até a compactação do ciclo seguinte).
+typedef struct {
+  int n_celulas;
+  int *inicio; // n_celulas + 1
+  int *cursor; // Posição de escrita por célula durante a construção
+  int *agente; // Índices dos agentes, agrupados por célula
+  int *celula; // Célula de cada agente
+  int capacidade_celulas;
+  int capacidade_agentes;
+  int *parcial; // Somas parciais por thread na soma de prefixos
+} Ocupacao;
+
+// Assinaturas
+void ocupacao_iniciar(Ocupacao *o);
+void ocupacao_liberar(Ocupacao *o);
+// Chamada por todas as threads de uma região paralela (ou fora de uma).
+void ocupacao_construir(Ocupacao *o, const Dominio *d, const Populacao *p);
+
+static inline int ocupacao_contagem(const Ocupacao *o, int idx) {
+  return o->inicio[idx + 1] - o->inicio[idx];
+}
+
+// Primeiro dos ocupacao_contagem(o, idx) agentes da célula idx.
+static inline const int *ocupacao_agentes(const Ocupacao *o, int idx) {
+  return &o->agente[o->inicio[idx]];
+}
+
+#endif
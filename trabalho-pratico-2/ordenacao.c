@@ -0,0 +1,160 @@
+#include "ordenacao.h"
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BITS_DIGITO 8
+#define N_DIGITOS (1 << BITS_DIGITO)
+
+static void *realocar(void *v, size_t bytes) {
+  v = realloc(v, bytes > 0 ? bytes : 1);
+  if (v == NULL) {
+    printf("Erro fatal de memoria na reordenacao (%zu bytes)!\n", bytes);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  return v;
+}
+
+void ordenacao_iniciar(Ordenacao *o) {
+  for (int k = 0; k < 2; k++) {
+    o->chave[k] = NULL;
+    o->indice[k] = NULL;
+  }
+  o->capacidade = 0;
+  o->histograma = (int *)realocar(
+      NULL, (size_t)omp_get_max_threads() * N_DIGITOS * sizeof(int));
+  o->n_reordenacoes = 0;
+  o->tempo = 0.0;
+}
+
+void ordenacao_liberar(Ordenacao *o) {
+  for (int k = 0; k < 2; k++) {
+    free(o->chave[k]);
+    free(o->indice[k]);
+  }
+  free(o->histograma);
+}
+
+// Mesmo critério de crescimento do índice de ocupação (dobra a capacidade).
+static void reservar(Ordenacao *o, int n) {
+  if (n <= o->capacidade) {
+    return;
+  }
+  int nova = (o->capacidade > 0) ? o->capacidade : 1024;
+  while (nova < n) {
+    nova *= 2;
+  }
+  for (int k = 0; k < 2; k++) {
+    o->chave[k] = (uint64_t *)realocar(o->chave[k], nova * sizeof(uint64_t));
+    o->indice[k] = (int *)realocar(o->indice[k], nova * sizeof(int));
+  }
+  o->capacidade = nova;
+}
+
+// Intercala os 32 bits baixos de v com zeros (bit i vai para 2i).
+static inline uint64_t espalhar_bits(uint64_t v) {
+  v &= 0xFFFFFFFFull;
+  v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+  v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+  v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+  v = (v | (v << 2)) & 0x3333333333333333ull;
+  v = (v | (v << 1)) & 0x5555555555555555ull;
+  return v;
+}
+
+// Bits necessários para representar valores em [0, n).
+static int bits_para(int n) {
+  int b = 0;
+  while ((1 << b) < n) {
+    b++;
+  }
+  return b;
+}
+
+void ordenacao_morton(Ordenacao *o, Populacao *dst, const Populacao *src,
+                      int W_local, int H_local) {
+  int n = src->n;
+  double inicio = omp_get_wtime();
+#pragma omp single
+  {
+    reservar(o, n);
+    dst->n = 0; // O conteúdo de dst é descartável, então nada é copiado
+    populacao_reservar(dst, n);
+  }
+
+  // Chave: trecho (interior/borda) acima do código de Morton de (x+1, y+1),
+  // que cabe em 2 * bits_coordenada bits
+  int bits_coordenada = bits_para((W_local > H_local ? W_local : H_local) + 2);
+  int bits_chave = 2 * bits_coordenada + 1;
+  uint64_t *restrict chave = o->chave[0];
+  int *restrict indice = o->indice[0];
+#pragma omp for
+  for (int i = 0; i < n; i++) {
+    uint64_t trecho = (i >= src->n_interior);
+    chave[i] = (trecho << (2 * bits_coordenada)) |
+               espalhar_bits((uint64_t)(src->x[i] + 1)) |
+               (espalhar_bits((uint64_t)(src->y[i] + 1)) << 1);
+    indice[i] = i;
+  }
+
+  int tid = omp_get_thread_num();
+  int nt = omp_get_num_threads();
+  int ini, fim;
+  populacao_faixa(n, nt, tid, &ini, &fim);
+  int *meu = &o->histograma[tid * N_DIGITOS];
+  int a = 0;
+  for (int desloc = 0; desloc < bits_chave; desloc += BITS_DIGITO) {
+    const uint64_t *restrict chave_de = o->chave[a];
+    const int *restrict indice_de = o->indice[a];
+    uint64_t *restrict chave_para = o->chave[1 - a];
+    int *restrict indice_para = o->indice[1 - a];
+
+    // 1. Histograma do trecho desta thread
+    for (int d = 0; d < N_DIGITOS; d++) {
+      meu[d] = 0;
+    }
+    for (int i = ini; i < fim; i++) {
+      meu[(chave_de[i] >> desloc) & (N_DIGITOS - 1)]++;
+    }
+#pragma omp barrier
+
+    // 2. Soma de prefixos por (dígito, thread): as threads escrevem cada
+    // dígito na ordem dos seus trechos, então a passada é estável
+#pragma omp single
+    {
+      int pos = 0;
+      for (int d = 0; d < N_DIGITOS; d++) {
+        for (int k = 0; k < nt; k++) {
+          int cont = o->histograma[k * N_DIGITOS + d];
+          o->histograma[k * N_DIGITOS + d] = pos;
+          pos += cont;
+        }
+      }
+    }
+
+    // 3. Distribuição
+    for (int i = ini; i < fim; i++) {
+      int p = meu[(chave_de[i] >> desloc) & (N_DIGITOS - 1)]++;
+      chave_para[p] = chave_de[i];
+      indice_para[p] = indice_de[i];
+    }
+    a = 1 - a;
+#pragma omp barrier
+  }
+
+  // 4. Os campos de cada agente são copiados uma vez, já na ordem final
+  const int *restrict ordem = o->indice[a];
+#pragma omp for
+  for (int j = 0; j < n; j++) {
+    populacao_copiar(dst, j, src, ordem[j]);
+  }
+
+#pragma omp single
+  {
+    dst->n = n;
+    dst->n_interior = src->n_interior;
+    o->n_reordenacoes++;
+    o->tempo += omp_get_wtime() - inicio;
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef ORDENACAO_H
+#define ORDENACAO_H
+
+#include <stdint.h>
+
+#include "populacao.h"
+
+// Reordenação periódica dos agentes locais pela curva de Morton (Z-order) de
+// (x, y): agentes vizinhos na lista passam a estar em células vizinhas, então
+// os acessos ao grid do movimento, do consumo e da carga ficam quase todos
+// no cache. A ordem [interior | borda] é preservada (o trecho entra como o
+// bit mais alto da chave) e a ordenação é estável.
+//
+// Radix sort LSD paralelo de 8 bits por passada sobre pares (chave, índice),
+// com histogramas por thread; os campos dos agentes são copiados uma vez só,
+// no fim, para a outra população do buffer duplo.
+typedef struct {
+  uint64_t *chave[2];
+  int *indice[2];
+  int capacidade;
+  int *histograma; // [threads * 256], posição de escrita por (thread, dígito)
+
+  int n_reordenacoes;
+  double tempo; // Gasto reordenando neste processo
+} Ordenacao;
+
+// Assinaturas
+void ordenacao_iniciar(Ordenacao *o);
+void ordenacao_liberar(Ordenacao *o);
+
+// Escreve em dst os agentes de src em ordem de Morton. Chamada por todas as
+// threads de uma região paralela (ou fora de uma); termina com uma barreira.
+void ordenacao_morton(Ordenacao *o, Populacao *dst, const Populacao *src,
+                      int W_local, int H_local);
+
+#endif
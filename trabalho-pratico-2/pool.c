@@ -0,0 +1,55 @@
+#include "pool.h"
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Total de realocações feitas por todos os buffers deste processo
+static long realocacoes = 0;
+
+void buffer_iniciar(BufferAgentes *b, int capacidade_inicial) {
+  b->n = 0;
+  b->capacidade = (capacidade_inicial > 16) ? capacidade_inicial : 16;
+  b->dados = (Agente *)malloc(b->capacidade * sizeof(Agente));
+  if (b->dados == NULL) {
+    printf("Erro fatal de memoria ao alocar buffer de %d agentes!\n",
+           b->capacidade);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+}
+
+// Dobra a capacidade até comportar capacidade_minima. Pode ser chamada de
+// dentro de regiões paralelas, desde que cada buffer pertença a uma thread.
+void buffer_crescer(BufferAgentes *b, int capacidade_minima) {
+  int nova = b->capacidade;
+  while (nova < capacidade_minima) {
+    nova *= 2;
+  }
+  Agente *dados = (Agente *)realloc(b->dados, nova * sizeof(Agente));
+  if (dados == NULL) {
+    printf("Erro fatal de memoria no realloc (%d agentes)!\n", nova);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  b->dados = dados;
+  b->capacidade = nova;
+  pool_contar_realocacao();
+}
+
+void buffer_liberar(BufferAgentes *b) {
+  free(b->dados);
+  b->dados = NULL;
+  b->n = b->capacidade = 0;
+}
+
+// Registra uma realocação feita por qualquer estrutura de agentes (buffers AoS
+// ou a população SoA).
+void pool_contar_realocacao(void) {
+#pragma omp atomic
+  realocacoes++;
+}
+
+long pool_realocacoes(void) {
+  long total;
+#pragma omp atomic read
+  total = realocacoes;
+  return total;
+}
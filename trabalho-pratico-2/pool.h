@@ -0,0 +1,34 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "agente.h"
+
+// Vetor de agentes persistente: alocado uma vez, reaproveitado entre ciclos
+// (basta zerar n) e crescido geometricamente quando falta espaço. Nenhum
+// agente é descartado por falta de capacidade.
+typedef struct {
+  Agente *dados;
+  int n;
+  int capacidade;
+} BufferAgentes;
+
+// Assinaturas
+void buffer_iniciar(BufferAgentes *b, int capacidade_inicial);
+void buffer_crescer(BufferAgentes *b, int capacidade_minima);
+void buffer_liberar(BufferAgentes *b);
+void pool_contar_realocacao(void);
+long pool_realocacoes(void);
+
+// Garante espaço para pelo menos capacidade_minima agentes.
+static inline void buffer_reservar(BufferAgentes *b, int capacidade_minima) {
+  if (capacidade_minima > b->capacidade) {
+    buffer_crescer(b, capacidade_minima);
+  }
+}
+
+static inline void buffer_adicionar(BufferAgentes *b, const Agente *a) {
+  buffer_reservar(b, b->n + 1);
+  b->dados[b->n++] = *a;
+}
+
+#endif
@@ -0,0 +1,401 @@
+#include "populacao.h"
+#include "numa.h"
+#include "rng.h"
+#include <float.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALINHAMENTO 64 // Uma linha de cache / um registrador AVX-512
+
+static const char *nomes_escalonamento[] = {"tarefas", "runtime", "custo"};
+
+int populacao_escalonamento_de(const char *nome, Escalonamento *modo) {
+  for (int k = 0; k < 3; k++) {
+    if (strcmp(nome, nomes_escalonamento[k]) == 0) {
+      *modo = (Escalonamento)k;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *populacao_escalonamento_nome(Escalonamento modo) {
+  return nomes_escalonamento[modo];
+}
+
+// Aloca um vetor alinhado, preservando os primeiros n_copiar bytes de antigo.
+static void *realocar_alinhado(void *antigo, size_t n_copiar, size_t bytes) {
+  bytes = (bytes + ALINHAMENTO - 1) / ALINHAMENTO * ALINHAMENTO;
+  void *novo = aligned_alloc(ALINHAMENTO, bytes);
+  if (novo == NULL) {
+    printf("Erro fatal de memoria ao alocar %zu bytes da populacao!\n", bytes);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  // As páginas vão para os nós das threads que percorrem cada trecho
+  numa_primeiro_toque(novo, bytes);
+  if (antigo != NULL) {
+    memcpy(novo, antigo, n_copiar);
+    free(antigo);
+  }
+  return novo;
+}
+
+static void redimensionar(Populacao *p, int capacidade) {
+  size_t n = (size_t)p->n, c = (size_t)capacidade;
+  p->x = realocar_alinhado(p->x, n * sizeof(int), c * sizeof(int));
+  p->y = realocar_alinhado(p->y, n * sizeof(int), c * sizeof(int));
+  p->gx = realocar_alinhado(p->gx, n * sizeof(int), c * sizeof(int));
+  p->gy = realocar_alinhado(p->gy, n * sizeof(int), c * sizeof(int));
+  p->energia =
+      realocar_alinhado(p->energia, n * sizeof(double), c * sizeof(double));
+  p->id = realocar_alinhado(p->id, n * sizeof(uint64_t), c * sizeof(uint64_t));
+  // A área de trabalho não precisa ser preservada entre ciclos
+  p->ganho = realocar_alinhado(p->ganho, 0, c * sizeof(double));
+  p->origem = realocar_alinhado(p->origem, 0, c * sizeof(int));
+  p->destino = realocar_alinhado(p->destino, 0, c * sizeof(uint8_t));
+  p->filhos = realocar_alinhado(p->filhos, 0, c * sizeof(uint8_t));
+  p->capacidade = capacidade;
+}
+
+void populacao_iniciar(Populacao *p, int capacidade_inicial) {
+  memset(p, 0, sizeof(*p));
+  redimensionar(p, capacidade_inicial > 16 ? capacidade_inicial : 16);
+}
+
+// Mesmo critério de crescimento dos buffers de pool.c (dobra a capacidade) e
+// mesma contagem de realocações.
+void populacao_crescer(Populacao *p, int capacidade_minima) {
+  int nova = p->capacidade;
+  while (nova < capacidade_minima) {
+    nova *= 2;
+  }
+  redimensionar(p, nova);
+  pool_contar_realocacao();
+}
+
+void populacao_liberar(Populacao *p) {
+  free(p->x);
+  free(p->y);
+  free(p->gx);
+  free(p->gy);
+  free(p->energia);
+  free(p->id);
+  free(p->ganho);
+  free(p->origem);
+  free(p->destino);
+  free(p->filhos);
+  memset(p, 0, sizeof(*p));
+}
+
+// Acrescenta os agentes recebidos na migração, recalculando as posições
+// locais a partir das globais.
+void populacao_desempacotar(Populacao *p, const BufferAgentes *recebidos,
+                            int offsetX, int offsetY) {
+  populacao_reservar(p, p->n + recebidos->n);
+  int base = p->n;
+  for (int k = 0; k < recebidos->n; k++) {
+    const Agente *a = &recebidos->dados[k];
+    int i = base + k;
+    p->gx[i] = a->gx;
+    p->gy[i] = a->gy;
+    p->x[i] = a->gx - offsetX;
+    p->y[i] = a->gy - offsetY;
+    p->energia[i] = a->energia;
+    p->id[i] = a->id;
+  }
+  p->n += recebidos->n;
+}
+
+// Gasta 1 unidade de energia por ciclo e soma o que foi consumido. Quem fica
+// sem energia morre (destino DESTINO_MORTO); quem chega a energia_reproducao
+// divide a energia ao meio com um filho (filhos[i] = 1), criado pela
+// compactação. Com energia_reproducao <= 0 não há reprodução. Retorna a
+// energia total dos vivos do trecho (filhos incluídos), para as métricas.
+double populacao_atualizar_energia(Populacao *p, int ini, int fim,
+                                   double energia_reproducao) {
+  double *restrict energia = p->energia;
+  const double *restrict ganho = p->ganho;
+  uint8_t *restrict destino = p->destino;
+  uint8_t *restrict filhos = p->filhos;
+  double limiar = (energia_reproducao > 0.0) ? energia_reproducao : DBL_MAX;
+  double soma = 0.0;
+#pragma omp simd reduction(+ : soma)
+  for (int i = ini; i < fim; i++) {
+    double e = (energia[i] - 1.0) + ganho[i];
+    int morre = (e <= 0.0);
+    int reproduz = (e >= limiar);
+    energia[i] = reproduz ? 0.5 * e : e;
+    filhos[i] = (uint8_t)reproduz;
+    destino[i] = morre ? (uint8_t)DESTINO_MORTO : destino[i];
+    soma += morre ? 0.0 : e;
+  }
+  return soma;
+}
+
+// Random walk com paredes globais. O passo vem do gerador baseado em contador
+// (id, ciclo, semente), que é só aritmética inteira e vetoriza junto com o
+// clamp e a classificação do destino. O agente recusa o passo se a célula
+// sorteada estiver esgotada e a atual ainda tiver recurso; para agentes da
+// borda essa célula pode ser do halo, então eles só podem ser movidos depois
+// que a troca de halo terminar. O grid não é escrito aqui (o consumo vem
+// depois, a partir de origem[]), então todos decidem sobre o mesmo estado.
+//
+// O recurso das células vem de grid_valor(); o modo de regeneração é
+// constante em cada chamada, e mover() é gerada uma vez para cada modo, sem
+// o desvio dentro do laço.
+static inline void mover(Populacao *p, int ini, int fim, unsigned int semente,
+                         int ciclo, const Paredes *paredes, const Grid *g,
+                         const int adiada) {
+  int *restrict x = p->x;
+  int *restrict y = p->y;
+  int *restrict gx = p->gx;
+  int *restrict gy = p->gy;
+  const uint64_t *restrict id = p->id;
+  int *restrict origem = p->origem;
+  uint8_t *restrict destino = p->destino;
+  const int min_x = paredes->min_x, max_x = paredes->max_x;
+  const int min_y = paredes->min_y, max_y = paredes->max_y;
+  const int W = paredes->W_local, H = paredes->H_local;
+  const int passo = paredes->passo;
+  const double *recurso = g->recurso;
+
+#pragma omp simd
+  for (int i = ini; i < fim; i++) {
+    uint64_t r = rng_agente(semente, id[i], (uint64_t)ciclo,
+                            RNG_FLUXO_MOVIMENTO);
+    int dx = (int)rng_intervalo((uint32_t)r, 3) - 1;
+    int dy = (int)rng_intervalo((uint32_t)(r >> 32), 3) - 1;
+
+    int novo_x = x[i] + dx;
+    int novo_y = y[i] + dy;
+    novo_x = (novo_x < min_x) ? min_x : (novo_x > max_x) ? max_x : novo_x;
+    novo_y = (novo_y < min_y) ? min_y : (novo_y > max_y) ? max_y : novo_y;
+
+    int idx_atual = (y[i] + 1) * passo + (x[i] + 1);
+    int idx_novo = (novo_y + 1) * passo + (novo_x + 1);
+    double r_novo =
+        adiada ? grid_valor_adiado(g, idx_novo, ciclo) : recurso[idx_novo];
+    double r_atual =
+        adiada ? grid_valor_adiado(g, idx_atual, ciclo) : recurso[idx_atual];
+    int fica = (r_novo <= 0.0) & (r_atual > 0.0);
+    novo_x = fica ? x[i] : novo_x;
+    novo_y = fica ? y[i] : novo_y;
+
+    origem[i] = idx_atual;
+    gx[i] += novo_x - x[i];
+    gy[i] += novo_y - y[i];
+    x[i] = novo_x;
+    y[i] = novo_y;
+
+    int sai_x = (novo_x >= W) - (novo_x < 0);
+    int sai_y = (novo_y >= H) - (novo_y < 0);
+    int codigo = (sai_y + 1) * 3 + (sai_x + 1);
+    int borda = (novo_x <= 0) | (novo_x >= W - 1) | (novo_y <= 0) |
+                (novo_y >= H - 1);
+    destino[i] = (uint8_t)(codigo + ((codigo == DESTINO_LOCAL) & borda) *
+                                        (DESTINO_BORDA - DESTINO_LOCAL));
+  }
+}
+
+void populacao_mover(Populacao *p, int ini, int fim, unsigned int semente,
+                     int ciclo, const Paredes *paredes, const Grid *g) {
+  if (g->adiada.ativa) {
+    mover(p, ini, fim, semente, ciclo, paredes, g, 1);
+  } else {
+    mover(p, ini, fim, semente, ciclo, paredes, g, 0);
+  }
+}
+
+void populacao_contagem_iniciar(ContagemDemanda *c, int n_threads) {
+  c->celula = NULL;
+  c->capacidade = 0;
+  c->contagem = (int *)malloc(n_threads * n_threads * sizeof(int));
+  c->inicio = (int *)malloc((n_threads + 1) * sizeof(int));
+  c->n_visitadas = (int *)malloc(n_threads * sizeof(int));
+}
+
+void populacao_contagem_liberar(ContagemDemanda *c) {
+  free(c->celula);
+  free(c->contagem);
+  free(c->inicio);
+  free(c->n_visitadas);
+}
+
+// Thread dona da célula idx entre n_partes (inversa de populacao_faixa()).
+static inline int dona_da_celula(int idx, int n_celulas, int n_partes) {
+  int base = n_celulas / n_partes, resto = n_celulas % n_partes;
+  int corte = resto * (base + 1);
+  return (idx < corte) ? idx / (base + 1) : resto + (idx - corte) / base;
+}
+
+// Conta em g->demanda os agentes [0, n) de p por célula de origem. Órfã e
+// chamada por todas as threads da região (termina numa barreira). Cada
+// thread agrupa as origens do seu trecho dos agentes por dona; depois cada
+// dona percorre o seu grupo, na ordem das threads e dos agentes, e
+// incrementa a demanda sem disputa. A lista de visitadas é escrita no
+// próprio grupo, atrás da leitura.
+void populacao_contar_demanda(const Populacao *p, int n, Grid *g,
+                              ContagemDemanda *c) {
+  int tid = omp_get_thread_num();
+  int nt = omp_get_num_threads();
+  int n_celulas = g->n_celulas;
+  const int *origem = p->origem;
+
+#pragma omp single
+  if (n > c->capacidade) {
+    c->capacidade = p->capacidade;
+    c->celula = (int *)realloc(c->celula, c->capacidade * sizeof(int));
+    if (c->celula == NULL) {
+      printf("Erro fatal de memoria na contagem da demanda (%d celulas)!\n",
+             c->capacidade);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+
+  int ini, fim;
+  populacao_faixa(n, nt, tid, &ini, &fim);
+  int *minha = &c->contagem[tid * nt];
+  for (int k = 0; k < nt; k++) {
+    minha[k] = 0;
+  }
+  for (int i = ini; i < fim; i++) {
+    minha[dona_da_celula(origem[i], n_celulas, nt)]++;
+  }
+#pragma omp barrier
+#pragma omp single
+  {
+    int pos = 0;
+    for (int k = 0; k < nt; k++) {
+      c->inicio[k] = pos;
+      for (int t = 0; t < nt; t++) {
+        int cont = c->contagem[t * nt + k];
+        c->contagem[t * nt + k] = pos;
+        pos += cont;
+      }
+    }
+    c->inicio[nt] = pos;
+  }
+  for (int i = ini; i < fim; i++) {
+    c->celula[minha[dona_da_celula(origem[i], n_celulas, nt)]++] = origem[i];
+  }
+#pragma omp barrier
+
+  int *demanda = g->demanda;
+  int base = c->inicio[tid], visitadas = 0;
+  for (int m = base; m < c->inicio[tid + 1]; m++) {
+    int idx = c->celula[m];
+    if (demanda[idx]++ == 0) {
+      c->celula[base + visitadas++] = idx;
+    }
+  }
+  c->n_visitadas[tid] = visitadas;
+#pragma omp barrier
+}
+
+// Copia src para dst com os agentes do interior antes dos da borda
+// (usada quando a população é montada fora da compactação do ciclo).
+void populacao_separar_borda(Populacao *dst, const Populacao *src,
+                             int W_local, int H_local) {
+  populacao_reservar(dst, src->n);
+  int j = 0;
+  for (int fase = 0; fase < 2; fase++) {
+    for (int i = 0; i < src->n; i++) {
+      if (populacao_na_borda(src->x[i], src->y[i], W_local, H_local) == fase) {
+        populacao_copiar(dst, j++, src, i);
+      }
+    }
+    if (fase == 0) {
+      dst->n_interior = j;
+    }
+  }
+  dst->n = j;
+}
+
+// Custo previsto da carga de um agente numa célula com recurso r: o mesmo
+// cálculo de executar_carga(), mais uma unidade pelo resto do trabalho
+static inline double custo_previsto(double r, int fator_carga) {
+  double iteracoes = r * fator_carga;
+  return 1.0 + (iteracoes < MAX_CUSTO_CARGA ? iteracoes : MAX_CUSTO_CARGA);
+}
+
+// Prevê o custo da carga de cada agente pelo recurso da sua célula e corta
+// [0, n) em até n_trechos trechos de custo parecido: o trecho k é
+// [corte[k], corte[k + 1]), e o número de trechos vai em *n_cortados. O
+// recurso de cada agente fica em ganho[], que só volta a ser usado no
+// consumo, para que a carga não dependa da posição (o movimento pode estar
+// correndo ao mesmo tempo).
+//
+// Chamada por todas as threads da região paralela (termina numa barreira):
+// cada uma soma o custo do seu trecho de agentes (populacao_faixa), uma só
+// acumula os nt totais em parcial[] (nt + 1 posições) e cada thread marca
+// os cortes cujos alvos caem entre parcial[tid] e parcial[tid + 1].
+void populacao_cortar_por_custo(Populacao *p, const Paredes *paredes,
+                                const Grid *g, int ciclo, int fator_carga,
+                                int n_trechos, int *corte, int *n_cortados,
+                                double *parcial) {
+  int tid = omp_get_thread_num();
+  int nt = omp_get_num_threads();
+  int ini, fim;
+  populacao_faixa(p->n, nt, tid, &ini, &fim);
+
+  double soma = 0.0;
+  for (int i = ini; i < fim; i++) {
+    double r =
+        grid_valor(g, (p->y[i] + 1) * paredes->passo + (p->x[i] + 1), ciclo);
+    p->ganho[i] = r;
+    soma += custo_previsto(r, fator_carga);
+  }
+  parcial[tid + 1] = soma;
+
+#pragma omp barrier
+#pragma omp single
+  {
+    parcial[0] = 0.0;
+    for (int k = 1; k <= nt; k++) {
+      parcial[k] += parcial[k - 1];
+    }
+    // Alvos que nenhuma thread alcança (arredondamento no fim) cortam em n
+    for (int k = 1; k < n_trechos; k++) {
+      corte[k] = p->n;
+    }
+  }
+
+  // Cada alvo alvo * k pertence a uma única thread, a do intervalo
+  // (parcial[tid], parcial[tid + 1]] onde cai; o corte fica logo depois do
+  // primeiro agente do trecho em que o custo acumulado o alcança
+  double alvo = parcial[nt] / n_trechos;
+  int k = 1;
+  while (k < n_trechos && alvo * k <= parcial[tid]) {
+    k++;
+  }
+  double acumulado = parcial[tid];
+  for (int i = ini; i < fim && k < n_trechos && alvo * k <= parcial[tid + 1];
+       i++) {
+    acumulado += custo_previsto(p->ganho[i], fator_carga);
+    while (k < n_trechos && alvo * k <= parcial[tid + 1] &&
+           acumulado >= alvo * k) {
+      corte[k++] = i + 1;
+    }
+  }
+  while (k < n_trechos && alvo * k <= parcial[tid + 1]) {
+    corte[k++] = fim;
+  }
+
+#pragma omp barrier
+#pragma omp single
+  {
+    // Alvos próximos caem no mesmo agente: os cortes repetidos somem
+    int m = 0;
+    corte[0] = 0;
+    for (int k = 1; k < n_trechos; k++) {
+      if (corte[k] > corte[m] && corte[k] < p->n) {
+        corte[++m] = corte[k];
+      }
+    }
+    corte[++m] = p->n;
+    *n_cortados = m;
+  }
+}
@@ -0,0 +1,152 @@
+#ifndef POPULACAO_H
+#define POPULACAO_H
+
+#include <stdint.h>
+
+#include "agente.h"
+#include "grid.h"
+#include "pool.h"
+#include "rng.h"
+
+// Destino de um agente após o movimento, codificado como
+// (sai_y + 1) * 3 + (sai_x + 1), com sai_* em {-1, 0, 1}. O valor 4 indica
+// que o agente continua no interior do bloco local e 9 que continua no bloco,
+// mas no anel de borda (cuja vizinhança inclui células de halo). DESTINO_MORTO
+// marca o agente que ficou sem energia: a compactação simplesmente não o
+// copia.
+#define DESTINO_LOCAL 4
+#define DESTINO_BORDA 9
+#define DESTINO_MORTO 10
+#define N_DESTINOS 11
+
+// Agentes locais em estrutura de vetores (SoA): cada campo fica num vetor
+// alinhado próprio, de modo que os kernels de energia e movimento percorrem
+// memória contígua e podem ser vetorizados. A struct Agente (AoS) continua
+// sendo o formato de troca nas mensagens MPI.
+//
+// Os agentes ficam ordenados em dois trechos: [0, n_interior) são os do
+// interior do bloco, que não dependem do halo para decidir o movimento, e
+// [n_interior, n) os do anel de borda (incluindo os recém-chegados).
+typedef struct {
+  int n;
+  int n_interior;
+  int capacidade;
+  int *x, *y;   // Posições locais
+  int *gx, *gy; // Posições globais
+  double *energia;
+  uint64_t *id;
+
+  // Área de trabalho por agente, válida apenas dentro de um ciclo
+  double *ganho;    // Recurso consumido no ciclo
+  int *origem;      // Célula (dominio_idx) ocupada no início do ciclo
+  uint8_t *destino; // Código de destino após o movimento
+  uint8_t *filhos;  // Filhos gerados no ciclo (0 ou 1)
+} Populacao;
+
+// Limites de movimento no bloco local. Em bordas globais o limite é a última
+// célula; onde há vizinho o agente pode sair uma célula e migrar.
+typedef struct {
+  int min_x, max_x;
+  int min_y, max_y;
+  int W_local, H_local;
+  int passo; // W_local + 2: largura do grid com halo
+} Paredes;
+
+// Repartição da carga sintética dos agentes entre as threads. O custo de um
+// agente é proporcional ao recurso da sua célula (zero numa INTERDITA, até
+// MAX_CUSTO_CARGA iterações), então trechos de mesmo tamanho podem custar
+// muito diferente.
+typedef enum {
+  ESCALONAMENTO_TAREFAS, // Tarefas de tamanho fixo, junto com o movimento
+  ESCALONAMENTO_RUNTIME, // Laço schedule(runtime), conforme OMP_SCHEDULE
+  ESCALONAMENTO_CUSTO,   // Tarefas cortadas por custo previsto parecido
+} Escalonamento;
+
+// Contagem da demanda de cada célula sem incrementos atômicos: cada thread
+// é dona de um trecho contíguo das células (a divisão de populacao_faixa()
+// sobre o plano com halo, a mesma das linhas no first touch) e só ela
+// incrementa a demanda das suas. As células de origem dos agentes são
+// agrupadas por dona num counting sort de nt baldes.
+//
+// Depois da contagem, o trecho [inicio[k], inicio[k] + n_visitadas[k]) de
+// celula traz as células da dona k que tiveram demanda no ciclo, cada uma
+// uma vez (a lista da regeneração adiada).
+typedef struct {
+  int *celula;   // Células de origem agrupadas por dona
+  int capacidade;
+  int *contagem; // [nt * nt]: por (thread, dona), depois posição de escrita
+  int *inicio;   // [nt + 1]: início do trecho de cada dona
+  int *n_visitadas; // [nt]
+} ContagemDemanda;
+
+// Assinaturas
+int populacao_escalonamento_de(const char *nome, Escalonamento *modo);
+const char *populacao_escalonamento_nome(Escalonamento modo);
+void populacao_iniciar(Populacao *p, int capacidade_inicial);
+void populacao_crescer(Populacao *p, int capacidade_minima);
+void populacao_liberar(Populacao *p);
+void populacao_desempacotar(Populacao *p, const BufferAgentes *recebidos,
+                            int offsetX, int offsetY);
+double populacao_atualizar_energia(Populacao *p, int ini, int fim,
+                                   double energia_reproducao);
+void populacao_mover(Populacao *p, int ini, int fim, unsigned int semente,
+                     int ciclo, const Paredes *paredes, const Grid *g);
+void populacao_separar_borda(Populacao *dst, const Populacao *src,
+                             int W_local, int H_local);
+void populacao_contagem_iniciar(ContagemDemanda *c, int n_threads);
+void populacao_contagem_liberar(ContagemDemanda *c);
+void populacao_contar_demanda(const Populacao *p, int n, Grid *g,
+                              ContagemDemanda *c);
+void populacao_cortar_por_custo(Populacao *p, const Paredes *paredes,
+                                const Grid *g, int ciclo, int fator_carga,
+                                int n_trechos, int *corte, int *n_cortados,
+                                double *parcial);
+
+// Id do filho gerado pelo agente id no ciclo: um hash de (semente, id,
+// ciclo), o mesmo em qualquer decomposição e escalonamento.
+static inline uint64_t populacao_id_filho(unsigned int semente, uint64_t id,
+                                          int ciclo) {
+  return rng_agente(semente, id, (uint64_t)ciclo, RNG_FLUXO_REPRODUCAO);
+}
+
+// Verdadeiro se (x, y) está no anel de borda do bloco (ou fora dele).
+static inline int populacao_na_borda(int x, int y, int W_local, int H_local) {
+  return (x <= 0) | (x >= W_local - 1) | (y <= 0) | (y >= H_local - 1);
+}
+
+// Trecho contíguo [ini, fim) de n agentes atribuído à parte k de n_partes
+// (mesma divisão de um schedule(static) sem chunk).
+static inline void populacao_faixa(int n, int n_partes, int k, int *ini,
+                                   int *fim) {
+  int base = n / n_partes, resto = n % n_partes;
+  *ini = k * base + (k < resto ? k : resto);
+  *fim = *ini + base + (k < resto ? 1 : 0);
+}
+
+static inline void populacao_reservar(Populacao *p, int capacidade_minima) {
+  if (capacidade_minima > p->capacidade) {
+    populacao_crescer(p, capacidade_minima);
+  }
+}
+
+static inline void populacao_copiar(Populacao *dst, int j,
+                                    const Populacao *src, int i) {
+  dst->x[j] = src->x[i];
+  dst->y[j] = src->y[i];
+  dst->gx[j] = src->gx[i];
+  dst->gy[j] = src->gy[i];
+  dst->energia[j] = src->energia[i];
+  dst->id[j] = src->id[i];
+}
+
+// Converte o agente i para o formato AoS usado na migração.
+static inline void populacao_empacotar(const Populacao *p, int i, Agente *a) {
+  a->x = p->x[i];
+  a->y = p->y[i];
+  a->gx = p->gx[i];
+  a->gy = p->gy[i];
+  a->energia = p->energia[i];
+  a->id = p->id[i];
+}
+
+#endif
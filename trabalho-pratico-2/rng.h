@@ -0,0 +1,40 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Gerador baseado em contador: em vez de um estado compartilhado (como o de
+// rand()), cada número é uma função pura de (semente, id do agente, ciclo,
+// fluxo). Não há trava nem dependência da ordem de execução das threads ou da
+// decomposição entre processos, então a mesma semente sempre produz as mesmas
+// trajetórias.
+
+// Finalizador do SplitMix64: espalha bem os bits de entradas consecutivas.
+static inline uint64_t rng_misturar(uint64_t z) {
+  z += 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Fluxos independentes para cada uso do gerador
+enum {
+  RNG_FLUXO_NASCIMENTO = 0,
+  RNG_FLUXO_MOVIMENTO = 1,
+  RNG_FLUXO_REPRODUCAO = 2
+};
+
+static inline uint64_t rng_agente(uint64_t semente, uint64_t id,
+                                  uint64_t ciclo, uint64_t fluxo) {
+  uint64_t h = rng_misturar(semente ^ (fluxo << 56));
+  h = rng_misturar(h ^ id);
+  return rng_misturar(h ^ ciclo);
+}
+
+// Inteiro em [0, n) a partir de 32 bits do valor sorteado (viés desprezível
+// para n pequeno em relação a 2^32).
+static inline uint32_t rng_intervalo(uint32_t bits, uint32_t n) {
+  return (uint32_t)(((uint64_t)bits * n) >> 32);
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *crescer(void *v, int *capacidade, int n, size_t tamanho) {
+  if (n <= *capacidade) {
+    return v;
+  }
+  v = realloc(v, n * tamanho);
+  if (v == NULL) {
+    printf("Erro fatal de memoria no snapshot (%d itens)!\n", n);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  *capacidade = n;
+  return v;
+}
+
+// Com arquivo vazio o snapshot fica desligado (cada = 0) e nada é aberto.
+void snapshot_abrir(Snapshot *s, const char *arquivo, const Dominio *d,
+                    int cada, int reducao) {
+  memset(s, 0, sizeof(*s));
+  s->arquivo = MPI_FILE_NULL;
+  if (arquivo == NULL || arquivo[0] == '\0') {
+    return;
+  }
+  s->cada = cada;
+  s->reducao = reducao;
+  int primeira;
+  s->largura_amostra = snapshot_amostras(0, d->W_global, reducao, &primeira);
+  s->altura_amostra = snapshot_amostras(0, d->H_global, reducao, &primeira);
+
+  if (MPI_File_open(d->comm, arquivo, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                    MPI_INFO_NULL, &s->arquivo) != MPI_SUCCESS) {
+    printf("Erro ao criar o arquivo de snapshots %s\n", arquivo);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  MPI_File_set_size(s->arquivo, 0); // Apaga execuções anteriores
+  MPI_Type_contiguous(sizeof(AgenteSnapshot), MPI_BYTE, &s->tipo_registro);
+  MPI_Type_commit(&s->tipo_registro);
+
+  if (d->rank == 0) {
+    CabecalhoSnapshot cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.assinatura, SNAPSHOT_ASSINATURA, 8);
+    cab.tamanho_registro = sizeof(AgenteSnapshot);
+    cab.largura = d->W_global;
+    cab.altura = d->H_global;
+    cab.reducao = reducao;
+    cab.largura_amostra = s->largura_amostra;
+    cab.altura_amostra = s->altura_amostra;
+    MPI_File_write_at(s->arquivo, 0, &cab, sizeof(cab), MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  }
+  s->fim = sizeof(CabecalhoSnapshot);
+  s->bytes = sizeof(CabecalhoSnapshot);
+}
+
+void snapshot_gravar(Snapshot *s, const Dominio *d, const Grid *g,
+                     const Populacao *p, int ciclo, int estacao) {
+  double inicio = MPI_Wtime();
+  int r = s->reducao;
+
+  // Agentes amostrados deste processo e a sua posição no quadro
+  int n_local = 0;
+  s->registros = (AgenteSnapshot *)crescer(
+      s->registros, &s->capacidade_registros, p->n, sizeof(AgenteSnapshot));
+  for (int i = 0; i < p->n; i++) {
+    if (p->id[i] % r != 0) {
+      continue;
+    }
+    AgenteSnapshot *a = &s->registros[n_local++];
+    a->id = p->id[i];
+    a->gx = p->gx[i];
+    a->gy = p->gy[i];
+    a->energia = p->energia[i];
+  }
+  long long n = n_local, antes = 0, total = 0;
+  MPI_Exscan(&n, &antes, 1, MPI_LONG_LONG, MPI_SUM, d->comm);
+  MPI_Allreduce(&n, &total, 1, MPI_LONG_LONG, MPI_SUM, d->comm);
+  if (d->rank == 0) {
+    antes = 0; // MPI_Exscan não define o valor no rank 0
+  }
+
+  MPI_Offset inicio_plano = s->fim + sizeof(QuadroSnapshot);
+  MPI_Offset inicio_agentes =
+      inicio_plano +
+      (MPI_Offset)s->largura_amostra * s->altura_amostra * sizeof(float);
+  MPI_Offset tamanho =
+      inicio_agentes + total * (MPI_Offset)sizeof(AgenteSnapshot) - s->fim;
+
+  if (d->rank == 0) {
+    QuadroSnapshot q;
+    memset(&q, 0, sizeof(q));
+    q.ciclo = ciclo;
+    q.estacao = estacao;
+    q.n_agentes = total;
+    q.tamanho = tamanho;
+    MPI_File_write_at(s->arquivo, s->fim, &q, sizeof(q), MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  }
+
+  // Grid: as células amostradas do bloco, copiadas para um plano contíguo e
+  // gravadas numa escrita coletiva, cada processo no seu retângulo da amostra
+  int x0, y0;
+  int nx = snapshot_amostras(d->offsetX, d->W_local, r, &x0);
+  int ny = snapshot_amostras(d->offsetY, d->H_local, r, &y0);
+  int n_celulas = (nx > 0 && ny > 0) ? nx * ny : 0;
+  s->plano = (float *)crescer(s->plano, &s->capacidade_plano, n_celulas,
+                              sizeof(float));
+  for (int j = 0; j < ny && n_celulas > 0; j++) {
+    int y = (y0 + j) * r - d->offsetY;
+    for (int i = 0; i < nx; i++) {
+      int x = (x0 + i) * r - d->offsetX;
+      s->plano[j * nx + i] = (float)g->recurso[dominio_idx(d, x, y)];
+    }
+  }
+
+  MPI_Datatype tipo_arquivo = MPI_FLOAT; // Bloco sem células amostradas
+  if (n_celulas > 0) {
+    int tamanhos[2] = {s->altura_amostra, s->largura_amostra};
+    int subtamanhos[2] = {ny, nx};
+    int offset[2] = {y0, x0};
+    MPI_Type_create_subarray(2, tamanhos, subtamanhos, offset, MPI_ORDER_C,
+                             MPI_FLOAT, &tipo_arquivo);
+    MPI_Type_commit(&tipo_arquivo);
+  }
+  MPI_File_set_view(s->arquivo, inicio_plano, MPI_FLOAT, tipo_arquivo,
+                    "native", MPI_INFO_NULL);
+  MPI_File_write_all(s->arquivo, s->plano, n_celulas, MPI_FLOAT,
+                     MPI_STATUS_IGNORE);
+  if (n_celulas > 0) {
+    MPI_Type_free(&tipo_arquivo);
+  }
+
+  // Agentes: trechos contíguos, na ordem dos ranks
+  MPI_File_set_view(s->arquivo, inicio_agentes, s->tipo_registro,
+                    s->tipo_registro, "native", MPI_INFO_NULL);
+  MPI_File_write_at_all(s->arquivo, antes, s->registros, n_local,
+                        s->tipo_registro, MPI_STATUS_IGNORE);
+
+  // Volta à vista em bytes, usada pelos cabeçalhos
+  MPI_File_set_view(s->arquivo, 0, MPI_BYTE, MPI_BYTE, "native",
+                    MPI_INFO_NULL);
+  s->fim += tamanho;
+  s->bytes += tamanho;
+  s->n_quadros++;
+  s->tempo += MPI_Wtime() - inicio;
+}
+
+void snapshot_fechar(Snapshot *s) {
+  if (s->arquivo != MPI_FILE_NULL) {
+    MPI_File_close(&s->arquivo);
+    MPI_Type_free(&s->tipo_registro);
+  }
+  free(s->plano);
+  free(s->registros);
+}
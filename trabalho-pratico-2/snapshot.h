@@ -0,0 +1,45 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <mpi.h>
+
+#include "dominio.h"
+#include "grid.h"
+#include "populacao.h"
+#include "snapshot_formato.h"
+
+// Gravação dos snapshots (formato em snapshot_formato.h): o arquivo fica
+// aberto a execução toda e cada quadro é acrescentado com escritas coletivas
+// de MPI-IO. Todos os processos acompanham o fim do arquivo, então nenhum
+// precisa consultá-lo.
+typedef struct {
+  MPI_File arquivo;
+  int cada;    // Ciclos entre quadros
+  int reducao; // Passo da amostragem do grid e dos agentes
+  int largura_amostra, altura_amostra;
+  MPI_Offset fim; // Início do próximo quadro
+  MPI_Datatype tipo_registro;
+
+  // Áreas de trabalho, crescidas sob demanda
+  float *plano;
+  int capacidade_plano;
+  AgenteSnapshot *registros;
+  int capacidade_registros;
+
+  int n_quadros;
+  long long bytes;
+  double tempo; // Gravação dos quadros neste processo
+} Snapshot;
+
+// Assinaturas (coletivas)
+void snapshot_abrir(Snapshot *s, const char *arquivo, const Dominio *d,
+                    int cada, int reducao);
+void snapshot_gravar(Snapshot *s, const Dominio *d, const Grid *g,
+                     const Populacao *p, int ciclo, int estacao);
+void snapshot_fechar(Snapshot *s);
+
+static inline int snapshot_na_vez(const Snapshot *s, int t) {
+  return s->cada > 0 && t % s->cada == 0;
+}
+
+#endif
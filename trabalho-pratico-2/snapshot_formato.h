@@ -0,0 +1,49 @@
+#ifndef SNAPSHOT_FORMATO_H
+#define SNAPSHOT_FORMATO_H
+
+#include <stdint.h>
+
+// Formato do arquivo de snapshots (sem dependência de MPI, para ser lido
+// também pela ferramenta em ferramentas/ler_snapshot.c):
+//
+//   [CabecalhoSnapshot]
+//   quadro 0: [QuadroSnapshot] [grid amostrado] [agentes amostrados]
+//   quadro 1: ...
+//
+// O grid amostrado é o recurso das células com gx e gy múltiplos da redução,
+// largura_amostra x altura_amostra floats em ordem de linhas; os agentes
+// amostrados são os de id múltiplo da redução, n_agentes AgenteSnapshot.
+// QuadroSnapshot.tamanho permite pular de um quadro ao seguinte. Inteiros e
+// números reais ficam na representação nativa.
+#define SNAPSHOT_ASSINATURA "SIMSNP01"
+
+typedef struct {
+  char assinatura[8];
+  uint32_t tamanho_registro; // sizeof(AgenteSnapshot), confere o formato
+  int32_t largura, altura;   // Grid global
+  int32_t reducao;           // Passo da amostragem (1 = tudo)
+  int32_t largura_amostra, altura_amostra;
+} CabecalhoSnapshot;
+
+typedef struct {
+  int32_t ciclo;
+  int32_t estacao;
+  int64_t n_agentes;
+  int64_t tamanho; // Bytes do quadro, cabeçalho incluído
+} QuadroSnapshot;
+
+typedef struct {
+  uint64_t id;
+  int32_t gx, gy;
+  double energia;
+} AgenteSnapshot;
+
+// Células amostradas numa faixa [ini, ini + n) de um eixo: as de coordenada
+// múltipla de reducao. *primeira recebe o índice (na amostra) da primeira.
+static inline int snapshot_amostras(int ini, int n, int reducao,
+                                    int *primeira) {
+  *primeira = (ini + reducao - 1) / reducao;
+  return (ini + n + reducao - 1) / reducao - *primeira;
+}
+
+#endif
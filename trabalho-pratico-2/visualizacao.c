@@ -1,6 +1,8 @@
 #include "visualizacao.h"
 #include <mpi.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define RESET "\x1B[0m"
 #define RED "\x1B[31m"
@@ -11,57 +13,218 @@
 #define CYAN "\x1B[36m"
 #define GRY "\x1B[90m"
 
-void visualizar_subgrid(int rank, int W_local, int H_local, int offsetY,
-                        Celula *grid, Agente *agentes, int n_agentes) {
-  // Pequena pausa para não atropelar a impressão de outros processos
-  MPI_Barrier(MPI_COMM_WORLD);
-
-  printf("\n--- Processo MPI Rank %d (Linhas Globais: %d a %d) ---\n", rank,
-         offsetY, offsetY + H_local - 1);
-
-  for (int j = 0; j < H_local; j++) {
-    for (int i = 0; i < W_local; i++) {
-      int idx = j * W_local + i;
-      bool tem_agente = false;
-
-      // Verifica se há algum agente nesta célula local
-      for (int k = 0; k < n_agentes; k++) {
-        if (agentes[k].x == i && agentes[k].y == j) {
-          tem_agente = true;
-          break;
-        }
-      }
+// Pior caso por célula: posicionamento do cursor, cor e o símbolo
+#define BYTES_CELULA 32
+#define LINHA_GRID 2 // Linha do terminal onde começa o grid (1 = cabeçalho)
+
+static const char *nomes_modo[] = {"terreno", "densidade"};
+
+// Símbolo de cada tipo de célula, na ordem de TipoCelula
+static const char simbolo_tipo[N_TIPOS] = {'H', '~', 'f', '#', 'X'};
+
+int visualizacao_modo_de(const char *nome, ModoVisualizacao *modo) {
+  for (int k = 0; k < 2; k++) {
+    if (strcmp(nome, nomes_modo[k]) == 0) {
+      *modo = (ModoVisualizacao)k;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *visualizacao_nome(ModoVisualizacao modo) {
+  return nomes_modo[modo];
+}
+
+static void *alocar(size_t bytes) {
+  void *p = malloc(bytes > 0 ? bytes : 1);
+  if (p == NULL) {
+    printf("Erro fatal de memoria na visualizacao (%zu bytes)!\n", bytes);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  return p;
+}
+
+void visualizacao_iniciar(Visualizacao *v, const Dominio *d,
+                          ModoVisualizacao modo, int diferencas) {
+  memset(v, 0, sizeof(*v));
+  v->modo = modo;
+  v->diferencas = diferencas;
+  if (d->rank != 0) {
+    return;
+  }
+  size_t celulas = (size_t)d->W_global * d->H_global;
+  v->recebidos = (char *)alocar(celulas);
+  v->quadro = (char *)alocar(celulas);
+  v->anterior = (char *)alocar(celulas);
+  v->contagem = (int *)alocar(2 * d->size * sizeof(int));
+  v->desloc = v->contagem + d->size;
+  v->capacidade_texto = celulas * BYTES_CELULA + d->H_global * 16 + 256;
+  v->texto = (char *)alocar(v->capacidade_texto);
+}
+
+void visualizacao_liberar(Visualizacao *v) {
+  free(v->bloco);
+  free(v->recebidos);
+  free(v->quadro);
+  free(v->anterior);
+  free(v->contagem);
+  free(v->texto);
+}
+
+// Símbolo de uma célula. A ocupação de cada célula vem do índice (O(1) por
+// célula), então codificar o bloco custa O(células).
+static char simbolo(const Grid *g, const Ocupacao *o, int idx,
+                    ModoVisualizacao modo) {
+  int n_agentes = ocupacao_contagem(o, idx);
+  if (n_agentes > 0) {
+    if (modo == VIS_DENSIDADE) {
+      return (n_agentes <= 9) ? (char)('0' + n_agentes) : '+';
+    }
+    return '@';
+  }
+  // Célula não interditada e sem recursos
+  if (g->recurso[idx] <= 0.0 && g->tipo[idx] != INTERDITA) {
+    return '0';
+  }
+  return simbolo_tipo[g->tipo[idx]];
+}
+
+static const char *cor(char c) {
+  switch (c) {
+  case 'H':
+    return MAG;
+  case '~':
+    return BLU;
+  case 'f':
+    return GRN;
+  case '#':
+    return YEL;
+  case 'X':
+    return RESET;
+  case '0':
+    return GRY;
+  default:
+    return RED; // Agentes (@, 1-9, +)
+  }
+}
 
-      if (tem_agente) {
-        printf(RED " @ " RESET); // Agente representado por @ vermelho
-      } else {
-        // Se a célula não for interditada e estiver sem recursos, imprime um
-        // ponto cinza
-        if (grid[idx].recurso <= 0.0 && grid[idx].tipo != INTERDITA) {
-          printf(GRY " 0 " RESET);
-        } else {
-          // Caso contrário, imprime o terreno normal colorido
-          switch (grid[idx].tipo) {
-          case ALDEIA:
-            printf(MAG " H " RESET);
-            break;
-          case PESCA:
-            printf(BLU " ~ " RESET);
-            break;
-          case COLETA:
-            printf(GRN " f " RESET);
-            break;
-          case ROCADO:
-            printf(YEL " # " RESET);
-            break;
-          case INTERDITA:
-            printf(" X ");
-            break;
-          }
-        }
+// Acrescenta a célula c ao texto, trocando de cor só quando ela muda.
+static char *escrever_celula(char *p, char c, const char **cor_atual) {
+  const char *nova = cor(c);
+  if (nova != *cor_atual) {
+    size_t n = strlen(nova);
+    memcpy(p, nova, n);
+    p += n;
+    *cor_atual = nova;
+  }
+  p[0] = ' ';
+  p[1] = c;
+  p[2] = ' ';
+  return p + 3;
+}
+
+// Monta o quadro do rank 0 em v->texto e devolve o seu tamanho.
+static size_t compor(Visualizacao *v, const Dominio *d, int ciclo,
+                     Estacao estacao) {
+  int W = d->W_global, H = d->H_global;
+  int completo = !v->diferencas || !v->tem_anterior;
+  char *p = v->texto;
+  const char *cor_atual = RESET;
+
+  // Cabeçalho, sempre reescrito; o quadro completo limpa a tela antes
+  p += sprintf(p, "%s" RESET "Ciclo %d | Estacao %s | %d processos (%dx%d)"
+               "\x1B[K\n",
+               completo ? "\x1B[H\x1B[2J" : "\x1B[H", ciclo,
+               estacao == SECA ? "SECA" : "CHEIA", d->size, d->dims[1],
+               d->dims[0]);
+
+  for (int j = 0; j < H; j++) {
+    const char *linha = &v->quadro[(size_t)j * W];
+    const char *antes = &v->anterior[(size_t)j * W];
+    if (completo) {
+      for (int i = 0; i < W; i++) {
+        p = escrever_celula(p, linha[i], &cor_atual);
+      }
+      p += sprintf(p, "\n");
+      continue;
+    }
+    // Só as células alteradas; células vizinhas alteradas dispensam o
+    // reposicionamento do cursor
+    int cursor = -1;
+    for (int i = 0; i < W; i++) {
+      if (linha[i] == antes[i]) {
+        continue;
+      }
+      if (cursor != i) {
+        p += sprintf(p, "\x1B[%d;%dH", LINHA_GRID + j, 3 * i + 1);
       }
+      p = escrever_celula(p, linha[i], &cor_atual);
+      cursor = i + 1;
+    }
+  }
+
+  p += sprintf(p, RESET);
+  if (!completo) {
+    p += sprintf(p, "\x1B[%d;1H", LINHA_GRID + H); // Cursor abaixo do grid
+  }
+  return (size_t)(p - v->texto);
+}
+
+void visualizar(Visualizacao *v, const Dominio *d, const Grid *grid,
+                const Ocupacao *ocupacao, int ciclo, Estacao estacao) {
+  // 1. Codifica o bloco local
+  int n = d->W_local * d->H_local;
+  if (n > v->capacidade_bloco) {
+    free(v->bloco);
+    v->bloco = (char *)alocar(n);
+    v->capacidade_bloco = n;
+  }
+  for (int j = 0; j < d->H_local; j++) {
+    for (int i = 0; i < d->W_local; i++) {
+      v->bloco[j * d->W_local + i] =
+          simbolo(grid, ocupacao, dominio_idx(d, i, j), v->modo);
+    }
+  }
+
+  // 2. O rank 0 recebe todos os blocos. Os limites de cada bloco são
+  // conhecidos por todos, então as contagens não precisam ser trocadas; os
+  // ranks seguem a ordem das linhas (coords[0] * dims[1] + coords[1]).
+  if (d->rank == 0) {
+    int total = 0;
+    for (int q = 0; q < d->size; q++) {
+      int cy = q / d->dims[1], cx = q % d->dims[1];
+      v->contagem[q] = (d->limites_x[cx + 1] - d->limites_x[cx]) *
+                       (d->limites_y[cy + 1] - d->limites_y[cy]);
+      v->desloc[q] = total;
+      total += v->contagem[q];
     }
-    printf("\n");
   }
+  MPI_Gatherv(v->bloco, n, MPI_CHAR, v->recebidos, v->contagem, v->desloc,
+              MPI_CHAR, 0, d->comm);
+  if (d->rank != 0) {
+    return;
+  }
+
+  // 3. Monta o grid global e escreve o quadro numa só chamada
+  int W = d->W_global;
+  for (int q = 0; q < d->size; q++) {
+    int cy = q / d->dims[1], cx = q % d->dims[1];
+    int x0 = d->limites_x[cx], y0 = d->limites_y[cy];
+    int w = d->limites_x[cx + 1] - x0;
+    int h = d->limites_y[cy + 1] - y0;
+    for (int j = 0; j < h; j++) {
+      memcpy(&v->quadro[(size_t)(y0 + j) * W + x0],
+             &v->recebidos[v->desloc[q] + j * w], w);
+    }
+  }
+
+  size_t tamanho = compor(v, d, ciclo, estacao);
+  fwrite(v->texto, 1, tamanho, stdout);
   fflush(stdout);
+
+  char *troca = v->anterior;
+  v->anterior = v->quadro;
+  v->quadro = troca;
+  v->tem_anterior = 1;
 }
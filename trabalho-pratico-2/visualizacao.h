@@ -1,10 +1,47 @@
 #ifndef VISUALIZACAO_H
 #define VISUALIZACAO_H
 
-#include "agente.h"
+#include <stddef.h>
+
+#include "dominio.h"
 #include "grid.h"
+#include "ocupacao.h"
+
+typedef enum {
+  VIS_TERRENO,   // Terreno colorido, com @ onde há agentes
+  VIS_DENSIDADE, // Número de agentes por célula (1-9, + acima disso)
+} ModoVisualizacao;
+
+// Renderizador de quadros: cada processo codifica o seu bloco com um byte
+// (o símbolo) por célula, o rank 0 junta os blocos com um MPI_Gatherv e
+// escreve o quadro inteiro de uma vez. No modo de diferenças só as células
+// que mudaram desde o quadro anterior são reescritas (posicionando o cursor).
+typedef struct {
+  ModoVisualizacao modo;
+  int diferencas;
+
+  char *bloco; // Símbolos do bloco local, em ordem de linhas
+  int capacidade_bloco;
+
+  // Só no rank 0
+  char *recebidos; // Blocos de todos os processos, na ordem dos ranks
+  char *quadro;    // Grid global montado
+  char *anterior;  // Último quadro escrito (modo de diferenças)
+  int tem_anterior;
+  int *contagem, *desloc;
+  char *texto; // Quadro pronto para o terminal
+  size_t capacidade_texto;
+} Visualizacao;
+
+int visualizacao_modo_de(const char *nome, ModoVisualizacao *modo);
+const char *visualizacao_nome(ModoVisualizacao modo);
+void visualizacao_iniciar(Visualizacao *v, const Dominio *d,
+                          ModoVisualizacao modo, int diferencas);
+void visualizacao_liberar(Visualizacao *v);
 
-void visualizar_subgrid(int rank, int W_local, int H_local, int offsetY,
-                        Celula *grid, Agente *agentes, int n_agentes);
+// Coletiva (uma única MPI_Gatherv). A ocupação deve refletir as posições
+// atuais dos agentes.
+void visualizar(Visualizacao *v, const Dominio *d, const Grid *grid,
+                const Ocupacao *ocupacao, int ciclo, Estacao estacao);
 
 #endif